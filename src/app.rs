@@ -19,7 +19,7 @@ use crate::{
     grid::{Grid, LineUpdate},
     history::History,
     layout::Layout,
-    list::{self, grep::RegexConfig, WalkBuilderConfig},
+    list::{self, grep::RegexConfig, FileMatches, WalkBuilderConfig},
     lsp::{
         completion::CompletionItem,
         goto_definition_response::GotoDefinitionResponse,
@@ -45,10 +45,12 @@ use std::{
     path::{Path, PathBuf},
     rc::Rc,
     sync::{
-        mpsc::{Receiver, Sender},
+        mpsc::{Receiver, RecvTimeoutError, Sender},
         Arc, Mutex,
     },
+    time::{Duration, Instant},
 };
+use tree_sitter_quickfix::ViewportProgress;
 use DispatchEditor::*;
 
 pub(crate) struct App<T: Frontend> {
@@ -78,6 +80,11 @@ pub(crate) struct App<T: Frontend> {
 }
 
 const GLOBAL_TITLE_BAR_HEIGHT: u16 = 1;
+
+/// How often a pending parse of the quickfix list is resumed. Each resume
+/// parses for one budget (see `VIEWPORT_PARSE_BUDGET` in `src/buffer.rs`), and
+/// the rest of the frame is spent waiting for messages.
+const QUICKFIX_PARSE_FRAME: Duration = Duration::from_millis(16);
 impl<T: Frontend> App<T> {
     #[cfg(test)]
     pub(crate) fn new(
@@ -145,7 +152,47 @@ impl<T: Frontend> App<T> {
 
         self.render()?;
 
-        while let Ok(message) = self.receiver.recv() {
+        // When the quickfix list was last parsed for one budget, and whether
+        // that parse got anywhere
+        let mut last_resume = Instant::now();
+        let mut resume_stalled = false;
+        loop {
+            // While the quickfix list is still being parsed, parse one budget
+            // of it per frame, and wait for messages for the rest of the
+            // frame, so that a huge list never delays input by more than one
+            // budget. Messages that keep arriving do not hold back the parse
+            // either, as it goes first once a frame is over. Without a
+            // pending parse, or once resuming stops making progress, block as
+            // usual.
+            let message = if !resume_stalled && self.layout.has_pending_quickfix_parse() {
+                let timeout = QUICKFIX_PARSE_FRAME.saturating_sub(last_resume.elapsed());
+                let received = if timeout.is_zero() {
+                    Err(RecvTimeoutError::Timeout)
+                } else {
+                    self.receiver.recv_timeout(timeout)
+                };
+                match received {
+                    Ok(message) => message,
+                    Err(RecvTimeoutError::Timeout) => {
+                        last_resume = Instant::now();
+                        match self.layout.resume_quickfix_parse() {
+                            ViewportProgress::Changed => self.render()?,
+                            ViewportProgress::Pending => {}
+                            ViewportProgress::Unchanged => resume_stalled = true,
+                        }
+                        continue;
+                    }
+                    Err(RecvTimeoutError::Disconnected) => break,
+                }
+            } else {
+                match self.receiver.recv() {
+                    Ok(message) => message,
+                    Err(_) => break,
+                }
+            };
+            // The message may have moved the viewport, or shown another list
+            resume_stalled = false;
+            let was_pending = self.layout.has_pending_quickfix_parse();
             match message {
                 AppMessage::Event(event) => self.handle_event(event),
                 AppMessage::LspNotification(notification) => {
@@ -172,6 +219,11 @@ impl<T: Frontend> App<T> {
             }
 
             self.render()?;
+            // A parse that started with this message has spent its first
+            // budget already, so the frame of that budget starts now
+            if !was_pending && self.layout.has_pending_quickfix_parse() {
+                last_resume = Instant::now();
+            }
         }
 
         self.quit()
@@ -1137,6 +1189,25 @@ impl<T: Frontend> App<T> {
                 self.context
                     .set_quickfix_list_source(QuickfixListSource::Custom);
             }
+            QuickfixListType::Files(files) => {
+                self.layout.clear_quickfix_list_items();
+                // Already grouped by file, see `WalkBuilderConfig::run_grouped`
+                for FileMatches { path, locations } in files {
+                    let editor = self.open_file(&path, OpenFileOption::Background)?;
+                    editor
+                        .borrow_mut()
+                        .editor_mut()
+                        .buffer_mut()
+                        .update_quickfix_list_items(
+                            locations
+                                .into_iter()
+                                .map(|location| QuickfixListItem::new(location, None))
+                                .collect_vec(),
+                        );
+                }
+                self.context
+                    .set_quickfix_list_source(QuickfixListSource::Custom);
+            }
             QuickfixListType::Bookmark => {
                 self.context
                     .set_quickfix_list_source(QuickfixListSource::Bookmark);
@@ -1210,7 +1281,7 @@ impl<T: Frontend> App<T> {
         if config.search().is_empty() {
             return Ok(());
         }
-        let locations = match config.mode {
+        let files = match config.mode {
             LocalSearchConfigMode::Regex(regex) => {
                 list::grep::run(&config.search(), walk_builder_config, regex)
             }
@@ -1223,12 +1294,7 @@ impl<T: Frontend> App<T> {
         }?;
         self.set_quickfix_list_type(
             ResponseContext::default().set_description("Global search"),
-            QuickfixListType::Items(
-                locations
-                    .into_iter()
-                    .map(|location| QuickfixListItem::new(location, None))
-                    .collect_vec(),
-            ),
+            QuickfixListType::Files(files),
         )?;
         Ok(())
     }
@@ -1834,6 +1900,11 @@ impl<T: Frontend> App<T> {
         self.layout.get_dropdown_infos_count()
     }
 
+    #[cfg(test)]
+    pub(crate) fn quickfix_tree_cache_hits(&self) -> u64 {
+        self.layout.quickfix_tree_cache().hits()
+    }
+
     pub(crate) fn render_quickfix_list(
         &mut self,
         quickfix_list: QuickfixList,
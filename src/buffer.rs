@@ -4,9 +4,10 @@ use crate::selection_mode::case_agnostic::CaseAgnostic;
 use crate::tree_sitter_traversal::{traverse, Order};
 use crate::{
     char_index_range::CharIndexRange,
-    components::{editor::Movement, suggestive_editor::Decoration},
+    components::{dropdown::ContentEdit, editor::Movement, suggestive_editor::Decoration},
     context::{LocalSearchConfig, LocalSearchConfigMode},
     edit::{Action, ActionGroup, Edit, EditTransaction},
+    grid::StyleKey,
     position::Position,
     selection::{CharIndex, Selection, SelectionSet},
     selection_mode::{AstGrep, ByteRange},
@@ -21,13 +22,197 @@ use shared::{
     canonicalized_path::CanonicalizedPath,
     language::{self, Language},
 };
-use std::{collections::HashSet, ops::Range};
+use std::{collections::HashSet, ops::Range, time::Duration};
 use tree_sitter::{Node, Parser, Tree};
+use tree_sitter_quickfix::{
+    changed_sections, BudgetedParser, ContentKey, QuickfixLayout, TreeCache, ViewportProgress,
+    ViewportTree,
+};
+
+/// How many lines around the viewport are parsed by [`Buffer::update_lazily`]
+const VIEWPORT_MARGIN_LINES: usize = 200;
+
+/// How long [`Buffer::parse_visible_lines`] may parse before input is handled
+/// again. The rest of the parse is done by [`Buffer::resume_parse`].
+const VIEWPORT_PARSE_BUDGET: Duration = Duration::from_millis(8);
+
+/// The parser of [`Buffer::viewport_tree`], which keeps a parse that ran out
+/// of budget until the next frame. A clone of the buffer starts over with a
+/// parser of its own.
+#[derive(Default)]
+struct ViewportParser(Option<BudgetedParser>);
+
+impl Clone for ViewportParser {
+    fn clone(&self) -> Self {
+        Self::default()
+    }
+}
+
+/// Parse `text` from scratch, or incrementally from `old_tree`. Quickfix
+/// lists are re-parsed whenever a dropdown opens or a search finishes, so
+/// their parsers come from the pool of the grammar crate instead of being set
+/// up again every time.
+fn parse(language: &tree_sitter::Language, text: &str, old_tree: Option<&Tree>) -> Option<Tree> {
+    if *language == tree_sitter_quickfix::language() {
+        return tree_sitter_quickfix::parser().parse(text, old_tree);
+    }
+    let mut parser = Parser::new();
+    parser.set_language(language).ok()?;
+    parser.parse(text, old_tree)
+}
+
+/// Like [`parse`], but reading the text from `rope`, see [`read_rope`]
+fn parse_rope(
+    language: &tree_sitter::Language,
+    rope: &Rope,
+    old_tree: Option<&Tree>,
+) -> Option<Tree> {
+    let mut input = read_rope(rope);
+    if *language == tree_sitter_quickfix::language() {
+        return tree_sitter_quickfix::parser().parse_with(&mut input, old_tree);
+    }
+    let mut parser = Parser::new();
+    parser.set_language(language).ok()?;
+    parser.parse_with(&mut input, old_tree)
+}
+
+/// Read `rope` for tree-sitter straight from its chunks, to avoid copying the
+/// whole content on every scroll
+fn read_rope<'a>(rope: &'a Rope) -> impl FnMut(usize, tree_sitter::Point) -> &'a [u8] + 'a {
+    move |byte, _| {
+        if byte >= rope.len_bytes() {
+            return &[][..];
+        }
+        let (chunk, chunk_start, _, _) = rope.chunk_at_byte(byte);
+        &chunk.as_bytes()[byte - chunk_start..]
+    }
+}
+
+/// The point of `byte` in `rope`
+fn point(rope: &Rope, byte: usize) -> tree_sitter::Point {
+    let row = rope.byte_to_line(byte);
+    tree_sitter::Point::new(row, byte - rope.line_to_byte(row))
+}
+
+/// The single edit that turns `rope` into `text`: the bytes from the returned
+/// start to the old end in `rope` are replaced by the bytes from the start to
+/// the new end in `text`. Everything around is the common prefix and suffix.
+fn common_affixes(rope: &Rope, text: &str) -> (usize, usize, usize) {
+    let new = text.as_bytes();
+    let old_len = rope.len_bytes();
+    let chunks = rope.chunks().collect_vec();
+    let mut prefix = 0;
+    for chunk in &chunks {
+        let chunk = chunk.as_bytes();
+        let common = chunk
+            .iter()
+            .zip(&new[prefix..])
+            .take_while(|(a, b)| a == b)
+            .count();
+        prefix += common;
+        if common < chunk.len() {
+            break;
+        }
+    }
+    let max_suffix = old_len.min(new.len()) - prefix;
+    let mut suffix = 0;
+    for chunk in chunks.iter().rev() {
+        let chunk = chunk.as_bytes();
+        let common = chunk
+            .iter()
+            .rev()
+            .zip(new[..new.len() - suffix].iter().rev())
+            .take_while(|(a, b)| a == b)
+            .count();
+        suffix += common;
+        if common < chunk.len() || suffix >= max_suffix {
+            break;
+        }
+    }
+    let mut suffix = suffix.min(max_suffix);
+    // The common bytes are the same in both texts, so a char boundary of
+    // `text` is a char boundary of the old content as well
+    while !text.is_char_boundary(prefix) {
+        prefix -= 1
+    }
+    while !text.is_char_boundary(new.len() - suffix) {
+        suffix -= 1
+    }
+    (prefix, old_len - suffix, new.len() - suffix)
+}
+
+/// The lines that an update of the content replaced, see
+/// [`Buffer::update_incrementally`] and [`Buffer::update_lazily`], so that
+/// [`Buffer::redecorate`] only has to decorate these lines again.
+#[derive(Debug, Clone, Default, PartialEq, Eq)]
+pub(crate) struct ChangedLines {
+    /// The lines `start..old_end` of the old content are now the lines
+    /// `start..new_end`
+    start: usize,
+    old_end: usize,
+    new_end: usize,
+    /// The lines of the new content to decorate again, sorted and disjoint.
+    /// They cover `start..new_end`, and whatever else changed around it.
+    lines: Vec<Range<usize>>,
+}
+
+impl ChangedLines {
+    fn new(
+        start: usize,
+        old_end: usize,
+        new_end: usize,
+        widened: impl IntoIterator<Item = Range<usize>>,
+    ) -> Self {
+        let mut lines = Vec::<Range<usize>>::new();
+        for range in std::iter::once(start..new_end)
+            .chain(widened)
+            .sorted_by_key(|range| range.start)
+        {
+            match lines.last_mut() {
+                Some(last) if range.start <= last.end => last.end = last.end.max(range.end),
+                _ => lines.push(range),
+            }
+        }
+        Self {
+            start,
+            old_end,
+            new_end,
+            lines,
+        }
+    }
+
+    pub(crate) fn lines(&self) -> &[Range<usize>] {
+        &self.lines
+    }
+
+    fn contains(&self, line: usize) -> bool {
+        let index = self.lines.partition_point(|range| range.end <= line);
+        self.lines
+            .get(index)
+            .map_or(false, |range| range.start <= line)
+    }
+
+    /// Where `line` of the old content is in the new content, or `None` if it
+    /// was replaced
+    fn new_line(&self, line: usize) -> Option<usize> {
+        if line < self.start {
+            Some(line)
+        } else if line >= self.old_end {
+            Some(line - self.old_end + self.new_end)
+        } else {
+            None
+        }
+    }
+}
 
 #[derive(Clone)]
 pub(crate) struct Buffer {
     rope: Rope,
     tree: Option<Tree>,
+    /// Set if only the lines around the viewport are parsed, see
+    /// [`Buffer::update_lazily`]
+    viewport_tree: Option<(ContentKey, ViewportTree)>,
+    viewport_parser: ViewportParser,
     treesitter_language: Option<tree_sitter::Language>,
     undo_tree: UndoTree<Patch>,
     language: Option<Language>,
@@ -37,6 +222,10 @@ pub(crate) struct Buffer {
     diagnostics: Vec<Diagnostic>,
     quickfix_list_items: Vec<QuickfixListItem>,
     decorations: Vec<Decoration>,
+    /// The revision of the dropdown render that the content is, if it is
+    /// one, see [`Buffer::update_from_render`]. Any other change of the
+    /// content clears it.
+    render_revision: Option<usize>,
 }
 
 #[derive(Clone, PartialEq, Eq, Hash, Debug)]
@@ -53,15 +242,11 @@ impl Buffer {
             rope: Rope::from_str(text),
             treesitter_language: language.clone(),
             language: None,
-            tree: {
-                let mut parser = Parser::new();
-                language.and_then(|language| {
-                    parser
-                        .set_language(&language)
-                        .ok()
-                        .and_then(|_| parser.parse(text, None))
-                })
-            },
+            tree: language
+                .as_ref()
+                .and_then(|language| parse(language, text, None)),
+            viewport_tree: None,
+            viewport_parser: ViewportParser::default(),
             path: None,
             highlighted_spans: HighlighedSpans::default(),
             bookmarks: Vec::new(),
@@ -69,6 +254,7 @@ impl Buffer {
             undo_tree: UndoTree::new(),
             diagnostics: Vec::new(),
             quickfix_list_items: Vec::new(),
+            render_revision: None,
         }
     }
     pub(crate) fn clear_quickfix_list_items(&mut self) {
@@ -99,6 +285,32 @@ impl Buffer {
         decorations.clone_into(&mut self.decorations)
     }
 
+    /// Like [`Buffer::set_decorations`], after an update that returned
+    /// `changed`: the decorations of the changed lines are replaced by the
+    /// ones of `decorations` on these lines, and the others are moved along
+    /// with their lines. Decorations of byte ranges cannot be moved, so they
+    /// are all replaced.
+    pub(crate) fn redecorate(
+        &mut self,
+        changed: &ChangedLines,
+        decorations: impl IntoIterator<Item = Decoration>,
+    ) {
+        let kept = std::mem::take(&mut self.decorations)
+            .into_iter()
+            .filter_map(|decoration| {
+                let line = decoration.selection_range().start_line()?;
+                let new_line = changed.new_line(line)?;
+                (!changed.contains(new_line)).then(|| decoration.move_to_line(new_line))
+            });
+        let replaced = decorations.into_iter().filter(|decoration| {
+            decoration
+                .selection_range()
+                .start_line()
+                .map_or(true, |line| changed.contains(line))
+        });
+        self.decorations = kept.chain(replaced).collect()
+    }
+
     pub(crate) fn save_bookmarks(&mut self, new_ranges: Vec<CharIndexRange>) {
         let old_ranges = std::mem::take(&mut self.bookmarks)
             .into_iter()
@@ -192,10 +404,7 @@ impl Buffer {
         language: Option<tree_sitter::Language>,
         text: &str,
     ) -> (Rope, Option<Tree>) {
-        let mut parser = Parser::new();
-        let tree = language
-            .map(|language| parser.set_language(&language))
-            .and_then(|_| parser.parse(text, None));
+        let tree = language.and_then(|language| parse(&language, text, None));
         // let start_char_index = edit.start;
         // let old_end_char_index = edit.end();
         // let new_end_char_index = edit.start + edit.new.len_chars();
@@ -254,9 +463,275 @@ impl Buffer {
     }
 
     pub(crate) fn update(&mut self, text: &str) {
+        self.drop_viewport_tree();
+        self.render_revision = None;
         (self.rope, self.tree) = Self::get_rope_and_tree(self.treesitter_language.clone(), text);
     }
 
+    /// Like [`Buffer::update`], but only the part of the content that differs
+    /// from `text` is replaced, and the tree is reparsed incrementally.
+    ///
+    /// Meant for content that is rendered again and again with small changes,
+    /// like a dropdown that is being filtered: the groups of the dropdown that
+    /// did not change render to the same bytes, so they are found in the
+    /// common prefix and suffix, and the cost of the update is proportional
+    /// to the changed groups only.
+    ///
+    /// Returns the lines whose decorations have to be set again, widened to
+    /// the sections of the tree that changed, or `None` if the whole content
+    /// was replaced.
+    pub(crate) fn update_incrementally(&mut self, text: &str) -> Option<ChangedLines> {
+        self.render_revision = None;
+        let (Some(tree), None) = (self.tree.take(), self.viewport_tree.as_ref()) else {
+            self.update(text);
+            return None;
+        };
+        let (start_byte, old_end_byte, new_end_byte) = common_affixes(&self.rope, text);
+        if start_byte == old_end_byte && start_byte == new_end_byte {
+            self.tree = Some(tree);
+            return Some(ChangedLines::default());
+        }
+        Some(self.replace_incrementally(
+            tree,
+            start_byte..old_end_byte,
+            &text[start_byte..new_end_byte],
+        ))
+    }
+
+    /// Like [`Buffer::update_incrementally`], for `content` rendered by a
+    /// dropdown. If the content of the buffer is the render that `edit`
+    /// applies to, only `edit` is applied, without comparing the rest of the
+    /// content, so that the cost of filtering a dropdown with many groups is
+    /// proportional to the groups that changed.
+    pub(crate) fn update_from_render(
+        &mut self,
+        content: &str,
+        revision: usize,
+        edit: Option<&ContentEdit>,
+    ) -> Option<ChangedLines> {
+        if self.render_revision == Some(revision) {
+            return Some(ChangedLines::default());
+        }
+        let changed = match (edit, self.tree.take()) {
+            (Some(edit), Some(tree))
+                if self.viewport_tree.is_none()
+                    && self.render_revision == Some(edit.base_revision) =>
+            {
+                Some(self.replace_incrementally(tree, edit.range.clone(), &edit.text))
+            }
+            (_, tree) => {
+                self.tree = tree;
+                self.update_incrementally(content)
+            }
+        };
+        debug_assert!(self.rope == content);
+        self.render_revision = Some(revision);
+        changed
+    }
+
+    /// Replace the bytes `range` of the content with `text`, and reparse
+    /// `tree`, the tree of the content, incrementally
+    fn replace_incrementally(
+        &mut self,
+        mut tree: Tree,
+        range: Range<usize>,
+        text: &str,
+    ) -> ChangedLines {
+        let (start_byte, old_end_byte) = (range.start, range.end);
+        let new_end_byte = start_byte + text.len();
+        let start_position = point(&self.rope, start_byte);
+        let old_end_position = point(&self.rope, old_end_byte);
+        let start_char = self.rope.byte_to_char(start_byte);
+        self.rope
+            .remove(start_char..self.rope.byte_to_char(old_end_byte));
+        self.rope.insert(start_char, text);
+        let new_end_position = point(&self.rope, new_end_byte);
+        tree.edit(&tree_sitter::InputEdit {
+            start_byte,
+            old_end_byte,
+            new_end_byte,
+            start_position,
+            old_end_position,
+            new_end_position,
+        });
+
+        self.tree = self
+            .treesitter_language
+            .as_ref()
+            .and_then(|language| parse_rope(language, &self.rope, Some(&tree)));
+        self.highlighted_spans = std::mem::take(&mut self.highlighted_spans).apply_edit(
+            &(start_byte..old_end_byte),
+            new_end_byte as isize - old_end_byte as isize,
+        );
+        let changed_sections = self
+            .tree
+            .as_ref()
+            .map(|new_tree| changed_sections(&tree, new_tree))
+            .unwrap_or_default();
+        ChangedLines::new(
+            start_position.row,
+            old_end_position.row + 1,
+            new_end_position.row + 1,
+            changed_sections.into_iter().map(|changed| changed.rows),
+        )
+    }
+
+    /// Like [`Buffer::update`], but only the sections around `visible_lines`
+    /// are parsed, and the rest is parsed by [`Buffer::parse_visible_lines`]
+    /// as it is scrolled into view.
+    /// The tree of the previous content is kept in `cache`, and the tree of
+    /// `text` is taken from `cache` if it was shown before.
+    /// The sections are taken from `layout` if it describes `text`, otherwise
+    /// `text` is scanned for them.
+    /// Only meant for the quickfix language, see [`ViewportTree`].
+    ///
+    /// Returns the lines whose decorations have to be set again, or `None`
+    /// if there is no language.
+    pub(crate) fn update_lazily(
+        &mut self,
+        text: &str,
+        layout: Option<&QuickfixLayout>,
+        visible_lines: Range<usize>,
+        cache: &mut TreeCache,
+    ) -> Option<ChangedLines> {
+        if let Some((key, viewport_tree)) = self.viewport_tree.take() {
+            cache.insert(key, viewport_tree)
+        }
+        self.render_revision = None;
+        // The previous content is gone, and so is any use in finishing its parse
+        if let Some(parser) = self.viewport_parser.0.as_mut() {
+            parser.abandon()
+        }
+        let (start_byte, old_end_byte, new_end_byte) = common_affixes(&self.rope, text);
+        let (start, old_end) = (
+            self.rope.byte_to_line(start_byte),
+            self.rope.byte_to_line(old_end_byte) + 1,
+        );
+        self.rope = Rope::from_str(text);
+        self.viewport_tree = self.treesitter_language.as_ref().map(|_| {
+            let key = ContentKey::new(text);
+            let viewport_tree = cache.get(key).unwrap_or_else(|| {
+                layout
+                    .and_then(|layout| {
+                        ViewportTree::from_layout(text, layout, VIEWPORT_MARGIN_LINES).ok()
+                    })
+                    .unwrap_or_else(|| ViewportTree::new(text, VIEWPORT_MARGIN_LINES))
+            });
+            (key, viewport_tree)
+        });
+        self.tree = self
+            .viewport_tree
+            .as_ref()
+            .and_then(|(_, viewport_tree)| viewport_tree.tree().cloned());
+        self.highlighted_spans = HighlighedSpans::default();
+        self.update_viewport_highlights(None);
+        self.parse_visible_lines(visible_lines);
+
+        // Most of the content is not parsed, so the replaced lines are
+        // widened to the sections they touch, instead of to the sections of
+        // the tree that changed
+        let (_, viewport_tree) = self.viewport_tree.as_ref()?;
+        if start_byte == old_end_byte && start_byte == new_end_byte {
+            return Some(ChangedLines::default());
+        }
+        let new_end = self.rope.byte_to_line(new_end_byte) + 1;
+        Some(ChangedLines::new(
+            start,
+            old_end,
+            new_end,
+            [viewport_tree.section_rows(start..new_end)],
+        ))
+    }
+
+    pub(crate) fn parse_visible_lines(&mut self, visible_lines: Range<usize>) {
+        let (Some(viewport_tree), Some(language)) = (
+            self.viewport_tree
+                .as_mut()
+                .map(|(_, viewport_tree)| viewport_tree),
+            self.treesitter_language.as_ref(),
+        ) else {
+            return;
+        };
+        let parser = self
+            .viewport_parser
+            .0
+            .get_or_insert_with(|| BudgetedParser::new(language, Some(VIEWPORT_PARSE_BUDGET)));
+        let mut input = read_rope(&self.rope);
+        if viewport_tree.ensure_visible_within(visible_lines, parser, &mut input)
+            != ViewportProgress::Changed
+        {
+            return;
+        }
+        self.update_viewport_tree()
+    }
+
+    /// Whether [`Buffer::parse_visible_lines`] ran out of budget, see
+    /// [`Buffer::resume_parse`]
+    pub(crate) fn has_pending_parse(&self) -> bool {
+        self.viewport_tree
+            .as_ref()
+            .map_or(false, |(_, viewport_tree)| viewport_tree.is_pending())
+    }
+
+    /// Continue the parse that [`Buffer::parse_visible_lines`] ran out of
+    /// budget for, for at most another budget. Returns
+    /// [`ViewportProgress::Unchanged`] if there was nothing left to parse.
+    pub(crate) fn resume_parse(&mut self) -> ViewportProgress {
+        let (Some((_, viewport_tree)), Some(parser)) =
+            (self.viewport_tree.as_mut(), self.viewport_parser.0.as_mut())
+        else {
+            return ViewportProgress::Unchanged;
+        };
+        let mut input = read_rope(&self.rope);
+        let progress = viewport_tree.resume(parser, &mut input);
+        if progress == ViewportProgress::Changed {
+            self.update_viewport_tree()
+        }
+        progress
+    }
+
+    /// Drop the viewport tree, and the parse of it that ran out of budget,
+    /// if any, so that [`Buffer::resume_parse`] has nothing left to do
+    fn drop_viewport_tree(&mut self) {
+        self.viewport_tree = None;
+        if let Some(parser) = self.viewport_parser.0.as_mut() {
+            parser.abandon()
+        }
+    }
+
+    fn update_viewport_tree(&mut self) {
+        let tree = self
+            .viewport_tree
+            .as_ref()
+            .and_then(|(_, viewport_tree)| viewport_tree.tree().cloned());
+        let old_tree = std::mem::replace(&mut self.tree, tree);
+        self.update_viewport_highlights(old_tree.as_ref())
+    }
+
+    /// Highlight the parts of the tree that changed since `old_tree`, using
+    /// the precompiled query of the quickfix language. The highlights of the
+    /// other parts are kept as they are.
+    fn update_viewport_highlights(&mut self, old_tree: Option<&Tree>) {
+        let Some(tree) = self.tree.as_ref() else {
+            return;
+        };
+        let changed = tree_sitter_quickfix::highlight_changed(tree, old_tree);
+        let capture_names = tree_sitter_quickfix::highlights_query().capture_names();
+        let mut spans = std::mem::take(&mut self.highlighted_spans).0;
+        spans.retain(|span| {
+            !changed
+                .changed_ranges
+                .iter()
+                .any(|range| range.start < span.byte_range.end && span.byte_range.start < range.end)
+        });
+        spans.extend(changed.spans.into_iter().map(|span| HighlighedSpan {
+            byte_range: span.byte_range,
+            style_key: StyleKey::Syntax(capture_names[span.capture_index as usize].to_string()),
+        }));
+        spans.sort_by_key(|span| span.byte_range.start);
+        self.highlighted_spans = HighlighedSpans(spans)
+    }
+
     pub(crate) fn get_line_by_char_index(&self, char_index: CharIndex) -> anyhow::Result<Rope> {
         Ok(self
             .rope
@@ -479,9 +954,13 @@ impl Buffer {
                 .collect_vec();
 
         // Update the content
+        self.render_revision = None;
         self.rope.try_remove(edit.range.start.0..edit.end().0)?;
         self.rope
             .try_insert(edit.range.start.0, edit.new.to_string().as_str())?;
+        // The sections of the viewport tree are byte offsets into the old
+        // content, so `parse_visible_lines` must not parse on from them
+        self.drop_viewport_tree();
 
         // Update all the positional spans (by using the char index ranges computed before the content is updated
         self.quickfix_list_items = quickfix_list_items_with_char_index_range
@@ -607,10 +1086,9 @@ impl Buffer {
     }
 
     pub(crate) fn reparse_tree(&mut self) -> anyhow::Result<()> {
-        let mut parser = tree_sitter::Parser::new();
-        if let Some(tree) = self.tree.as_ref() {
-            parser.set_language(&tree.language())?;
-            self.tree = parser.parse(&self.rope.to_string(), None);
+        if let Some(language) = self.tree.as_ref().map(|tree| tree.language()) {
+            self.drop_viewport_tree();
+            self.tree = parse(&language, &self.rope.to_string(), None);
         }
         Ok(())
     }
@@ -902,9 +1380,207 @@ impl Buffer {
 mod test_buffer {
     use itertools::Itertools;
 
-    use crate::selection::SelectionSet;
+    use crate::{
+        components::{
+            dropdown::{Dropdown, DropdownConfig, DropdownItem},
+            suggestive_editor::Decoration,
+        },
+        grid::StyleKey,
+        position::Position,
+        selection::SelectionSet,
+        selection_range::SelectionRange,
+    };
+
+    use super::{Buffer, ViewportParser};
+    use std::time::Duration;
+    use tree_sitter_quickfix::{BudgetedParser, ViewportProgress};
+
+    fn decorations_on(lines: &[usize]) -> Vec<Decoration> {
+        lines
+            .iter()
+            .map(|line| {
+                Decoration::new(
+                    SelectionRange::Position(Position::new(*line, 0)..Position::new(*line, 1)),
+                    StyleKey::UiFuzzyMatchedChar,
+                )
+            })
+            .collect()
+    }
+
+    #[test]
+    fn redecorate_should_move_the_decorations_of_unchanged_lines() {
+        let language = Some(tree_sitter_quickfix::language());
+        let old = "■┬ a.rs\n └─ 1:1  foo\n\n■┬ b.rs\n └─ 2:1  bar\n\n■┬ c.rs\n └─ 3:1  baz";
+        // The first section is removed, so the values move up by three lines
+        let new = "■┬ b.rs\n └─ 2:1  bar\n\n■┬ c.rs\n └─ 3:1  baz";
+        let decorated_lines = |buffer: &Buffer| {
+            buffer
+                .decorations()
+                .iter()
+                .filter_map(|decoration| decoration.selection_range().start_line())
+                .sorted()
+                .collect_vec()
+        };
+
+        let mut buffer = Buffer::new(language.clone(), old);
+        buffer.set_decorations(&decorations_on(&[1, 4, 7]));
+        let changed = buffer.update_incrementally(new).unwrap();
+        assert!(!changed.lines().is_empty());
+        buffer.redecorate(&changed, decorations_on(&[1, 4]));
+        assert_eq!(decorated_lines(&buffer), [1, 4]);
+
+        let mut cache = tree_sitter_quickfix::TreeCache::new(2);
+        let mut buffer = Buffer::new(language, "");
+        let changed = buffer.update_lazily(old, None, 0..10, &mut cache).unwrap();
+        buffer.redecorate(&changed, decorations_on(&[1, 4, 7]));
+        assert_eq!(decorated_lines(&buffer), [1, 4, 7]);
+        let changed = buffer.update_lazily(new, None, 0..10, &mut cache).unwrap();
+        // Only the section of b.rs, which the removed lines were replaced
+        // with, is decorated again
+        assert_eq!(changed.lines(), [0..3]);
+        buffer.redecorate(&changed, decorations_on(&[1]));
+        assert_eq!(decorated_lines(&buffer), [1, 4]);
+    }
 
-    use super::Buffer;
+    #[test]
+    fn update_from_render_should_apply_the_edit_of_the_render() {
+        let language = Some(tree_sitter_quickfix::language());
+        let mut dropdown = Dropdown::new(DropdownConfig {
+            title: "test".to_string(),
+        });
+        dropdown.set_items(
+            [("foo", "1"), ("bar", "2"), ("foo", "3")]
+                .into_iter()
+                .map(|(display, group)| {
+                    DropdownItem::new(display.to_string()).set_group(Some(group.to_string()))
+                })
+                .collect(),
+        );
+        let mut buffer = Buffer::new(language.clone(), "");
+        for filter in ["", "foo", "", "zzz", "bar", ""] {
+            dropdown.set_filter(filter);
+            let render = dropdown.render();
+            buffer.update_from_render(&render.content, render.revision, render.edit.as_ref());
+            assert_eq!(buffer.content(), render.content);
+            let expected = Buffer::new(language.clone(), &render.content);
+            assert_eq!(
+                buffer.tree.as_ref().unwrap().root_node().to_sexp(),
+                expected.tree.as_ref().unwrap().root_node().to_sexp()
+            );
+        }
+
+        // The content is no longer the render the next edit applies to
+        buffer.update("■┬ 4\n └─ spam");
+        dropdown.set_filter("foo");
+        let render = dropdown.render();
+        buffer.update_from_render(&render.content, render.revision, render.edit.as_ref());
+        assert_eq!(buffer.content(), render.content);
+    }
+
+    #[test]
+    fn update_incrementally_should_reuse_unchanged_parts() {
+        let language = Some(tree_sitter_quickfix::language());
+        let old = "■┬ a.rs\n ├─ 1:1  foo\n └─ 2:1  bar\n\n■┬ b.rs\n └─ 3:1  spam";
+        let mut buffer = Buffer::new(language.clone(), old);
+        for new in [
+            "■┬ a.rs\n └─ 2:1  bar\n\n■┬ b.rs\n └─ 3:1  spam",
+            "■┬ b.rs\n └─ 3:1  spam",
+            "■┬ b.rs\n └─ 3:1  spam",
+            "■┬ a.rs\n ├─ 1:1  foo\n └─ 2:1  bar\n\n■┬ b.rs\n └─ 3:1  spam",
+            "",
+        ] {
+            buffer.update_incrementally(new);
+            assert_eq!(buffer.content(), new);
+            let expected = Buffer::new(language.clone(), new);
+            assert_eq!(
+                buffer.tree.as_ref().unwrap().root_node().to_sexp(),
+                expected.tree.as_ref().unwrap().root_node().to_sexp()
+            );
+        }
+    }
+
+    #[test]
+    fn parse_of_visible_lines_should_be_resumable() {
+        let language = Some(tree_sitter_quickfix::language());
+        // One section that is much longer than the viewport margin, so that it
+        // may not fit the parse budget
+        let values = (0..100_000)
+            .map(|i| format!(" ├─ {i}:1  foo"))
+            .collect_vec()
+            .join("\n");
+        let text = format!("■┬ a.rs\n{values}\n └─ 0:1  bar");
+        let mut buffer = Buffer::new(language, "");
+        let mut cache = tree_sitter_quickfix::TreeCache::new(1);
+        buffer.update_lazily(&text, None, 0..10, &mut cache);
+        while buffer.has_pending_parse() {
+            buffer.resume_parse();
+        }
+        let root = buffer.tree.as_ref().unwrap().root_node();
+        assert!(!root.has_error());
+        let section = tree_sitter_quickfix::SectionSummary::of(root.child(0).unwrap()).unwrap();
+        assert_eq!(section.value_count, 100_001);
+
+        // Showing other content abandons a pending parse
+        buffer.update_lazily(&text.replace("foo", "spam"), None, 0..10, &mut cache);
+        buffer.update_lazily("■┬ b.rs\n └─ 1:1  x", None, 0..10, &mut cache);
+        while buffer.has_pending_parse() {
+            buffer.resume_parse();
+        }
+        assert_eq!(
+            buffer.tree.as_ref().unwrap().root_node().to_sexp(),
+            "(source_file (section (header (word)) (values (lastValue (word)))))"
+        );
+    }
+
+    #[test]
+    fn edit_should_drop_the_viewport_tree() {
+        let text = "■┬ a.rs\n └─ 1:1  foo\n\n■┬ b.rs\n └─ 2:1  bar";
+        let mut buffer = Buffer::new(Some(tree_sitter_quickfix::language()), "");
+        let mut cache = tree_sitter_quickfix::TreeCache::new(1);
+        buffer.update_lazily(text, None, 0..1, &mut cache);
+        assert!(buffer.viewport_tree.is_some());
+
+        // Like an edit in insert mode, which does not reparse
+        let edit_transaction = buffer
+            .get_edit_transaction(&text.replace("foo", "spam"))
+            .unwrap();
+        buffer
+            .apply_edit_transaction(&edit_transaction, SelectionSet::default(), false)
+            .unwrap();
+        assert!(buffer.viewport_tree.is_none());
+        // Nothing is parsed from the offsets of the old content
+        let sexp = |buffer: &Buffer| buffer.tree.as_ref().unwrap().root_node().to_sexp();
+        let before = sexp(&buffer);
+        buffer.parse_visible_lines(0..5);
+        assert_eq!(sexp(&buffer), before);
+    }
+
+    #[test]
+    fn edit_should_abandon_the_pending_parse() {
+        let language = tree_sitter_quickfix::language();
+        let text = (0..20_000)
+            .map(|i| format!("■┬ file_{i}.rs\n └─ 1:1  foo"))
+            .join("\n\n");
+        let mut buffer = Buffer::new(Some(language.clone()), "");
+        // A budget that no parse fits in
+        buffer.viewport_parser = ViewportParser(Some(BudgetedParser::new(
+            &language,
+            Some(Duration::from_micros(1)),
+        )));
+        let mut cache = tree_sitter_quickfix::TreeCache::new(1);
+        buffer.update_lazily(&text, None, 0..40_000, &mut cache);
+        assert!(buffer.has_pending_parse());
+
+        let edit_transaction = buffer
+            .get_edit_transaction(&text.replacen("foo", "spam", 1))
+            .unwrap();
+        buffer
+            .apply_edit_transaction(&edit_transaction, SelectionSet::default(), false)
+            .unwrap();
+        assert!(!buffer.has_pending_parse());
+        assert!(!buffer.viewport_parser.0.as_ref().unwrap().is_pending());
+        assert_eq!(buffer.resume_parse(), ViewportProgress::Unchanged);
+    }
 
     #[test]
     fn get_parent_lines_1() {
@@ -1,4 +1,9 @@
-use std::cmp::Reverse;
+use std::{
+    borrow::Cow,
+    cmp::Reverse,
+    ops::Range,
+    sync::atomic::{AtomicUsize, Ordering},
+};
 
 use crate::{app::Dispatches, components::editor::Movement, position::Position};
 
@@ -6,6 +11,7 @@ use itertools::Itertools;
 
 use nucleo_matcher::Utf32Str;
 use shared::{canonicalized_path::CanonicalizedPath, icons::get_icon_config};
+use tree_sitter_quickfix::QuickfixLayout;
 
 use super::suggestive_editor::{Decoration, Info};
 
@@ -104,7 +110,19 @@ pub(crate) struct Dropdown {
     filter: String,
     items: Vec<DropdownItem>,
     filtered_item_groups: Vec<FilteredDropdownItemGroup>,
+    /// The index of the first item of every group of `filtered_item_groups`,
+    /// so that the group of an item is found by binary search
+    group_first_item_indices: Vec<usize>,
     current_item_index: usize,
+    /// `filtered_item_groups` rendered, see [`Dropdown::update_content`]
+    content: String,
+    /// The length of every group in `content`, without the blank line that
+    /// separates it from the next group
+    group_lens: Vec<usize>,
+    /// Identifies `content`, see [`DropdownRender::edit`]
+    revision: usize,
+    /// How `content` changed from the previous revision
+    edit: Option<ContentEdit>,
 }
 
 pub(crate) struct DropdownConfig {
@@ -117,23 +135,33 @@ impl Dropdown {
             filter: String::new(),
             items: vec![],
             filtered_item_groups: vec![],
+            group_first_item_indices: vec![],
             current_item_index: 0,
             title: config.title,
+            content: String::new(),
+            group_lens: vec![],
+            revision: next_revision(),
+            edit: None,
         }
     }
 
     pub(crate) fn change_index(&mut self, index: usize) {
-        if !self.filtered_item_groups.iter().any(|group| {
-            group
-                .items
-                .iter()
-                .any(|item| item.item_index as usize == index)
-        }) {
+        if index >= self.filtered_item_count() {
             return;
         }
         self.current_item_index = index;
     }
 
+    /// Item indices are assigned consecutively across groups, so the last
+    /// group tells how many items there are
+    fn filtered_item_count(&self) -> usize {
+        self.group_first_item_indices
+            .last()
+            .zip(self.filtered_item_groups.last())
+            .map(|(first_item_index, group)| first_item_index + group.items.len())
+            .unwrap_or(0)
+    }
+
     fn current_item_line_index(&self) -> usize {
         self.item_line_index(self.current_item_index)
     }
@@ -175,51 +203,31 @@ impl Dropdown {
         self.change_index(0)
     }
 
-    fn groups(&self) -> Option<Vec<String>> {
-        let groups = self
-            .filtered_item_groups
-            .iter()
-            .filter_map(|group| group.group_key.clone())
-            .collect_vec();
-        if groups.is_empty() {
-            None
-        } else {
-            Some(groups)
-        }
-    }
-
     fn get_current_item_group_index(&self) -> Option<usize> {
         self.get_item_group_index(self.current_item_index)
     }
 
     fn get_item_group_index(&self, item_index: usize) -> Option<usize> {
-        self.filtered_item_groups
-            .iter()
-            .enumerate()
-            .find(|(_, group)| {
-                group
-                    .items
-                    .iter()
-                    .any(|item| item.item_index as usize == item_index)
-            })
-            .map(|(index, _)| index)
+        if item_index >= self.filtered_item_count() {
+            return None;
+        }
+        self.group_first_item_indices
+            .partition_point(|first_item_index| *first_item_index <= item_index)
+            .checked_sub(1)
     }
 
     fn change_group_index(&mut self, increment: bool) -> Option<()> {
-        let groups = self.groups()?;
         let current_group_index = self.get_current_item_group_index()?;
         let new_group_index = if increment {
             current_group_index.saturating_add(1)
         } else {
             current_group_index.saturating_sub(1)
         };
-        let new_group = groups.get(new_group_index)?;
-        let (new_item_index, _) = self
-            .filtered_item_groups
-            .iter()
-            .flat_map(|group| &group.items)
-            .find_position(|item| item.item.group.as_ref() == Some(new_group))?;
-        self.change_index(new_item_index);
+        self.filtered_item_groups
+            .get(new_group_index)?
+            .group_key
+            .as_ref()?;
+        self.change_index(self.group_first_item_indices[new_group_index]);
         Some(())
     }
 
@@ -236,10 +244,10 @@ impl Dropdown {
     }
 
     fn get_item_by_index(&self, item_index: usize) -> Option<DropdownItem> {
-        self.filtered_item_groups
-            .iter()
-            .flat_map(|group| &group.items)
-            .nth(item_index)
+        let group_index = self.get_item_group_index(item_index)?;
+        self.filtered_item_groups[group_index]
+            .items
+            .get(item_index - self.group_first_item_indices[group_index])
             .map(|item| item.item.clone())
     }
 
@@ -296,6 +304,7 @@ impl Dropdown {
             items: Vec<FilteredDropdownItemWithoutIndex>,
             fuzzy_matched_char_indices: Vec<u32>,
         }
+        let old_groups = std::mem::take(&mut self.filtered_item_groups);
         self.filtered_item_groups = matches
             .into_iter()
             .sorted_by_key(|(item, _)| item.group.clone())
@@ -400,6 +409,84 @@ impl Dropdown {
                 },
             )
             .collect_vec();
+        self.group_first_item_indices = self
+            .filtered_item_groups
+            .iter()
+            .map(|group| {
+                group
+                    .items
+                    .first()
+                    .map(|item| item.item_index as usize)
+                    .unwrap_or_default()
+            })
+            .collect();
+        self.update_content(&old_groups);
+    }
+
+    /// Render the groups of `filtered_item_groups` that differ from
+    /// `old_groups`, which `content` is the rendering of, into `content`, and
+    /// keep the change as `edit`.
+    ///
+    /// Filtering mostly keeps, drops or reorders whole groups, so only the
+    /// groups between the common leading and trailing groups are rendered
+    /// again, and an editor showing the previous revision only has to
+    /// replace and reparse these. Groups are compared by what they render to.
+    fn update_content(&mut self, old_groups: &[FilteredDropdownItemGroup]) {
+        let new_groups = &self.filtered_item_groups;
+        let renders_same = |(a, b): &(&FilteredDropdownItemGroup, &FilteredDropdownItemGroup)| {
+            a.group_key == b.group_key
+                && a.items.len() == b.items.len()
+                && a.items
+                    .iter()
+                    .zip(&b.items)
+                    .all(|(a, b)| a.item.display == b.item.display)
+        };
+        let (old_len, new_len) = (old_groups.len(), new_groups.len());
+        let mut prefix = old_groups
+            .iter()
+            .zip(new_groups)
+            .take_while(renders_same)
+            .count();
+        if prefix == old_len && prefix == new_len {
+            return;
+        }
+        let suffix = old_groups[prefix..]
+            .iter()
+            .rev()
+            .zip(new_groups[prefix..].iter().rev())
+            .take_while(renders_same)
+            .count();
+        if suffix == 0 {
+            // The last group is not followed by a blank line, so a common
+            // group that is the last one of only one side renders differently
+            prefix = prefix.min(old_len.min(new_len).saturating_sub(1))
+        }
+
+        // Every group but the last is followed by a blank line
+        let separated_len =
+            |lens: &[usize]| lens.iter().map(|len| len + "\n\n".len()).sum::<usize>();
+        let start = separated_len(&self.group_lens[..prefix]);
+        let old_end = self.content.len()
+            - separated_len(&self.group_lens[old_len - suffix..]).saturating_sub("\n\n".len());
+        let mut text = String::new();
+        let mut lens = Vec::with_capacity(new_len - suffix - prefix);
+        for index in prefix..new_len - suffix {
+            let group_start = text.len();
+            render_group(&new_groups[index], &mut text);
+            lens.push(text.len() - group_start);
+            if index + 1 < new_len {
+                text.push_str("\n\n");
+            }
+        }
+
+        self.content.replace_range(start..old_end, &text);
+        self.group_lens.splice(prefix..old_len - suffix, lens);
+        self.edit = Some(ContentEdit {
+            base_revision: self.revision,
+            range: start..old_end,
+            text,
+        });
+        self.revision = next_revision();
     }
 
     pub(crate) fn set_filter(&mut self, filter: &str) {
@@ -413,45 +500,59 @@ impl Dropdown {
 
     pub(crate) fn render(&self) -> DropdownRender {
         DropdownRender {
-            title: self.title.clone(),
-            content: self.content(),
             decorations: self.decorations(),
+            ..self.render_without_decorations()
+        }
+    }
+
+    /// Like [`Dropdown::render`], for when only the decorations of some lines
+    /// are needed, see [`Dropdown::decorations_in_lines`]
+    pub(crate) fn render_without_decorations(&self) -> DropdownRender {
+        DropdownRender {
+            title: self.title.clone(),
+            content: self.content.clone(),
+            revision: self.revision,
+            edit: self.edit.clone(),
+            quickfix_layout: self.quickfix_layout(),
+            decorations: Vec::new(),
             highlight_line_index: self.current_item_line_index(),
             info: self.current_item().and_then(|item| item.info),
         }
     }
 
-    fn content(&self) -> String {
-        self.filtered_item_groups
+    /// The layout of the quickfix sections of `content`, if every item
+    /// belongs to a group
+    fn quickfix_layout(&self) -> Option<QuickfixLayout> {
+        let mut layout = QuickfixLayout::default();
+        // Every item is one line, see `escape_line_breaks`, so rows can be
+        // counted while walking the groups
+        let (mut row, mut group_start) = (0, 0);
+        for (group_index, (group, len)) in self
+            .filtered_item_groups
             .iter()
-            .map(|group| {
-                if let Some(group_key) = group.group_key.as_ref() {
-                    let items_len = group.items.len();
-                    let items = group
-                        .items
-                        .iter()
-                        .enumerate()
-                        .map(|(index, item)| {
-                            let content = item.item.display();
-                            let indicator = if index == items_len.saturating_sub(1) {
-                                "└─"
-                            } else {
-                                "├─"
-                            };
-                            format!(" {} {}", indicator, content)
-                        })
-                        .join("\n");
-                    format!("■┬ {}\n{}", group_key, items)
-                } else {
-                    group
-                        .items
-                        .iter()
-                        .map(|item| item.item.display())
-                        .join("\n")
-                }
-            })
-            .collect::<Vec<String>>()
-            .join("\n\n")
+            .zip(&self.group_lens)
+            .enumerate()
+        {
+            let group_key = group.group_key.as_ref()?;
+            if group_index > 0 {
+                row += 2;
+            }
+            let mut line_end = group_start + HEADER.len() + escape_line_breaks(group_key).len();
+            layout.push_header(row, group_start, line_end);
+            for item in &group.items {
+                row += 1;
+                // After the line break and the indentation
+                let value_start = line_end + "\n ".len();
+                line_end = value_start
+                    + VALUE_INDICATOR.len()
+                    + escape_line_breaks(&item.item.display).len();
+                layout.push_value(value_start, line_end)
+            }
+            debug_assert_eq!(line_end, group_start + len);
+            group_start += len + "\n\n".len();
+        }
+        layout.set_len(self.content.len());
+        Some(layout)
     }
 
     pub(crate) fn apply_movement(&mut self, movement: Movement) {
@@ -487,65 +588,108 @@ impl Dropdown {
         self.current_item_index
     }
 
-    fn decorations(&self) -> Vec<Decoration> {
+    pub(crate) fn decorations(&self) -> Vec<Decoration> {
         self.filtered_item_groups
             .iter()
-            .flat_map(|group| {
-                let group_decorations = {
-                    let line_index = group
-                        .items
-                        .first()
-                        .map(|item| {
-                            self.item_line_index(item.item_index as usize)
-                                .saturating_sub(1)
-                        })
-                        .unwrap_or_default();
-                    let pad_left = 3;
-                    group
-                        .fuzzy_matched_char_indices
-                        .iter()
-                        .map(move |matched_char_index| {
-                            let column_index = (matched_char_index + pad_left) as usize;
-                            Decoration::new(
-                                crate::selection_range::SelectionRange::Position(
-                                    Position {
-                                        line: line_index,
-                                        column: column_index,
-                                    }..Position {
-                                        line: line_index,
-                                        column: column_index + 1,
-                                    },
-                                ),
-                                crate::grid::StyleKey::UiFuzzyMatchedChar,
-                            )
-                        })
-                };
-                let display_decorations = group.items.iter().flat_map(|item| {
-                    let line_index = self.item_line_index(item.item_index as usize);
-                    let pad_left = if item.item.group.is_some() { 4 } else { 0 };
-                    item.fuzzy_matched_char_indices
-                        .iter()
-                        .map(move |matched_char_index| {
-                            let column_index = (matched_char_index + pad_left) as usize;
-                            Decoration::new(
-                                crate::selection_range::SelectionRange::Position(
-                                    Position {
-                                        line: line_index,
-                                        column: column_index,
-                                    }..Position {
-                                        line: line_index,
-                                        column: column_index + 1,
-                                    },
-                                ),
-                                crate::grid::StyleKey::UiFuzzyMatchedChar,
-                            )
-                        })
-                });
-                group_decorations.chain(display_decorations)
-            })
+            .flat_map(|group| self.group_decorations(group))
             .collect_vec()
     }
 
+    /// The decorations of the groups overlapping `lines`, which must be
+    /// sorted. Decorations of these groups outside of `lines` are included
+    /// too.
+    pub(crate) fn decorations_in_lines(&self, lines: &[Range<usize>]) -> Vec<Decoration> {
+        let mut decorations = Vec::new();
+        // Ranges may overlap the same group, which is decorated once
+        let mut next_group = 0;
+        for lines in lines {
+            let first = self.filtered_item_groups.partition_point(|group| {
+                group.items.last().map_or(true, |item| {
+                    self.item_line_index(item.item_index as usize) < lines.start
+                })
+            });
+            let groups = self
+                .filtered_item_groups
+                .iter()
+                .enumerate()
+                .skip(first.max(next_group))
+                .take_while(|(_, group)| {
+                    group.items.first().map_or(false, |item| {
+                        // The title of the group is on the line above
+                        self.item_line_index(item.item_index as usize)
+                            .saturating_sub(1)
+                            < lines.end
+                    })
+                });
+            for (group_index, group) in groups {
+                decorations.extend(self.group_decorations(group));
+                next_group = group_index + 1;
+            }
+        }
+        decorations
+    }
+
+    fn group_decorations<'a>(
+        &'a self,
+        group: &'a FilteredDropdownItemGroup,
+    ) -> impl Iterator<Item = Decoration> + 'a {
+        let group_decorations = {
+            let line_index = group
+                .items
+                .first()
+                .map(|item| {
+                    self.item_line_index(item.item_index as usize)
+                        .saturating_sub(1)
+                })
+                .unwrap_or_default();
+            let pad_left = 3;
+            let columns = group.group_key.as_deref().and_then(escaped_columns);
+            group
+                .fuzzy_matched_char_indices
+                .iter()
+                .map(move |matched_char_index| {
+                    let column_index =
+                        escaped_column(columns.as_deref(), *matched_char_index) + pad_left;
+                    Decoration::new(
+                        crate::selection_range::SelectionRange::Position(
+                            Position {
+                                line: line_index,
+                                column: column_index,
+                            }..Position {
+                                line: line_index,
+                                column: column_index + 1,
+                            },
+                        ),
+                        crate::grid::StyleKey::UiFuzzyMatchedChar,
+                    )
+                })
+        };
+        let display_decorations = group.items.iter().flat_map(move |item| {
+            let line_index = self.item_line_index(item.item_index as usize);
+            let pad_left = if item.item.group.is_some() { 4 } else { 0 };
+            let columns = escaped_columns(&item.item.display);
+            item.fuzzy_matched_char_indices
+                .iter()
+                .map(move |matched_char_index| {
+                    let column_index =
+                        escaped_column(columns.as_deref(), *matched_char_index) + pad_left;
+                    Decoration::new(
+                        crate::selection_range::SelectionRange::Position(
+                            Position {
+                                line: line_index,
+                                column: column_index,
+                            }..Position {
+                                line: line_index,
+                                column: column_index + 1,
+                            },
+                        ),
+                        crate::grid::StyleKey::UiFuzzyMatchedChar,
+                    )
+                })
+        });
+        group_decorations.chain(display_decorations)
+    }
+
     pub(crate) fn no_matching_candidates(&self) -> bool {
         self.filtered_item_groups.is_empty()
     }
@@ -562,8 +706,101 @@ impl Dropdown {
     }
 }
 
+/// Identifies a rendering of a dropdown, unique across all dropdowns
+fn next_revision() -> usize {
+    static REVISION: AtomicUsize = AtomicUsize::new(0);
+    REVISION.fetch_add(1, Ordering::Relaxed)
+}
+
+const HEADER: &str = "■┬ ";
+/// Both indicators have the same length
+const VALUE_INDICATOR: &str = "├─ ";
+const LAST_VALUE_INDICATOR: &str = "└─ ";
+
+/// Render the items of `group` into `content`, every item on a line of its
+/// own, under a header if the group has a key
+fn render_group(group: &FilteredDropdownItemGroup, content: &mut String) {
+    if let Some(group_key) = group.group_key.as_ref() {
+        content.push_str(HEADER);
+        content.push_str(&escape_line_breaks(group_key));
+        let items_len = group.items.len();
+        for (index, item) in group.items.iter().enumerate() {
+            let indicator = if index == items_len.saturating_sub(1) {
+                LAST_VALUE_INDICATOR
+            } else {
+                VALUE_INDICATOR
+            };
+            content.push_str("\n ");
+            content.push_str(indicator);
+            content.push_str(&escape_line_breaks(&item.item.display));
+        }
+    } else {
+        for (index, item) in group.items.iter().enumerate() {
+            if index > 0 {
+                content.push('\n');
+            }
+            content.push_str(&escape_line_breaks(&item.item.display));
+        }
+    }
+}
+
+/// Every item must occupy exactly one line of the rendered content, otherwise
+/// the line of an item no longer follows from its index, and the quickfix
+/// grammar sees a line that does not start with a marker, which sends the
+/// parser into error recovery.
+///
+/// Markers that appear within a line need no escaping, because the `word`
+/// token of the quickfix grammar consumes everything up to the line break.
+fn escape_line_breaks(text: &str) -> Cow<'_, str> {
+    if text.contains(['\n', '\r']) {
+        Cow::Owned(
+            text.replace("\r\n", "\\n")
+                .replace('\n', "\\n")
+                .replace('\r', "\\r"),
+        )
+    } else {
+        Cow::Borrowed(text)
+    }
+}
+
+/// The column of every char of `text` once it is escaped by
+/// [`escape_line_breaks`], or `None` if escaping does not move any char
+fn escaped_columns(text: &str) -> Option<Vec<usize>> {
+    if !text.contains(['\n', '\r']) {
+        return None;
+    }
+    let mut columns = Vec::with_capacity(text.len());
+    let mut column = 0;
+    let mut chars = text.chars().peekable();
+    while let Some(char) = chars.next() {
+        columns.push(column);
+        match char {
+            // Becomes `\n`, which is as wide
+            '\r' if chars.peek() == Some(&'\n') => {
+                chars.next();
+                columns.push(column + 1);
+                column += 2
+            }
+            '\n' | '\r' => column += 2,
+            _ => column += 1,
+        }
+    }
+    Some(columns)
+}
+
+/// The column of the char `char_index` of a text whose chars are at
+/// `columns`, see [`escaped_columns`]
+fn escaped_column(columns: Option<&[usize]>, char_index: u32) -> usize {
+    let char_index = char_index as usize;
+    columns
+        .and_then(|columns| columns.get(char_index).copied())
+        .unwrap_or(char_index)
+}
+
 #[cfg(test)]
 mod test_dropdown {
+    use std::ops::Range;
+
     use itertools::Itertools as _;
     use quickcheck_macros::quickcheck;
 
@@ -750,6 +987,48 @@ mod test_dropdown {
         )
     }
 
+    #[test]
+    fn decorations_in_lines_should_only_decorate_overlapping_groups() {
+        let mut dropdown = Dropdown::new(DropdownConfig {
+            title: "test".to_string(),
+        });
+        dropdown.set_items(
+            [
+                Item::new("xa", "", "1"),
+                Item::new("xb", "", "2"),
+                Item::new("xc", "", "2"),
+                Item::new("xd", "", "3"),
+            ]
+            .into_iter()
+            .map(|item| item.into())
+            .collect(),
+        );
+        dropdown.set_filter("x");
+        let line = |decoration: &Decoration| match decoration.selection_range() {
+            SelectionRange::Position(range) => range.start.line,
+            SelectionRange::Byte(_) => unreachable!(),
+        };
+        // Group 1 is on lines 0 and 1, group 2 on lines 3 to 5, and group 3
+        // on lines 7 and 8
+        let in_lines = |lines: Range<usize>| {
+            dropdown
+                .decorations()
+                .into_iter()
+                .filter(|decoration| lines.contains(&line(decoration)))
+                .collect_vec()
+        };
+        assert_eq!(dropdown.decorations_in_lines(&[5..6]), in_lines(3..6));
+        assert_eq!(
+            dropdown.decorations_in_lines(&[0..1, 1..2, 8..9]),
+            [in_lines(0..2), in_lines(7..9)].concat()
+        );
+        assert_eq!(
+            dropdown.decorations_in_lines(&[0..9]),
+            dropdown.decorations()
+        );
+        assert_eq!(dropdown.decorations_in_lines(&[20..30]), []);
+    }
+
     #[test]
     fn test_next_prev_group() {
         let mut dropdown = Dropdown::new(DropdownConfig {
@@ -798,6 +1077,133 @@ mod test_dropdown {
         dropdown.assert_highlighted_content(" └─ a");
     }
 
+    #[test]
+    fn line_breaks_in_items_and_groups_are_escaped() {
+        let mut dropdown = Dropdown::new(DropdownConfig {
+            title: "test".to_string(),
+        });
+        dropdown.set_items(
+            [
+                Item::new("let x = \"├─ a\";\r\n└─ b", "", "src/\nmain.rs"),
+                Item::new("■┬ c", "", "src/\nmain.rs"),
+            ]
+            .into_iter()
+            .map(|item| item.into())
+            .collect(),
+        );
+        assert_eq!(
+            dropdown.render().content,
+            "
+■┬ src/\\nmain.rs
+ ├─ let x = \"├─ a\";\\n└─ b
+ └─ ■┬ c"
+                .trim()
+        );
+        dropdown.next_item();
+        dropdown.assert_highlighted_content(" └─ ■┬ c");
+    }
+
+    #[test]
+    fn filtering_should_only_render_the_groups_that_changed() {
+        let items = [
+            Item::new("foo", "", "1"),
+            Item::new("bar", "", "2"),
+            Item::new("foo", "", "3"),
+        ]
+        .into_iter()
+        .map(|item| item.into())
+        .collect_vec();
+        let mut dropdown = Dropdown::new(DropdownConfig {
+            title: "test".to_string(),
+        });
+        dropdown.set_items(items.clone());
+        let mut content = dropdown.render().content;
+        let mut revision = dropdown.render().revision;
+
+        dropdown.set_filter("foo");
+        let edit = dropdown.render().edit.unwrap();
+        // Only the dropped group is replaced
+        assert_eq!(&content[edit.range.clone()], "■┬ 2\n └─ bar\n\n");
+        assert_eq!(edit.text, "");
+
+        // "fo" keeps the groups of "f"
+        for filter in ["foo", "", "bar", "zzz", "", "f", "fo"] {
+            dropdown.set_filter(filter);
+            let render = dropdown.render();
+            if render.revision != revision {
+                let edit = render.edit.unwrap();
+                assert_eq!(edit.base_revision, revision);
+                content.replace_range(edit.range, &edit.text);
+                revision = render.revision;
+            }
+            assert_eq!(content, render.content);
+            let mut expected = Dropdown::new(DropdownConfig {
+                title: "test".to_string(),
+            });
+            expected.set_items(items.clone());
+            expected.set_filter(filter);
+            assert_eq!(render.content, expected.render().content);
+            assert_eq!(render.quickfix_layout, expected.render().quickfix_layout);
+        }
+    }
+
+    #[test]
+    fn fuzzy_match_chars_decorations_should_follow_escaped_line_breaks() {
+        let mut dropdown = Dropdown::new(DropdownConfig {
+            title: "test".to_string(),
+        });
+        dropdown.set_items(vec![Item::new("a\nbc\r\nde", "", "x\ry").into()]);
+        dropdown.set_filter("y de");
+        let render = dropdown.render();
+        assert_eq!(render.content, "■┬ x\\ry\n └─ a\\nbc\\nde");
+        let decorations = render
+            .decorations
+            .iter()
+            .map(|decoration| match decoration.selection_range() {
+                SelectionRange::Position(range) => (range.start.line, range.start.column),
+                range => panic!("Unexpected range {range:?}"),
+            })
+            .collect_vec();
+        assert_eq!(decorations, [(0, 6), (1, 11), (1, 12)]);
+        let lines = render.content.lines().collect_vec();
+        for (line, column) in decorations {
+            assert!("yde".contains(lines[line].chars().nth(column).unwrap()));
+        }
+    }
+
+    #[test]
+    fn quickfix_layout_should_describe_grouped_content() {
+        let mut dropdown = Dropdown::new(DropdownConfig {
+            title: "test".to_string(),
+        });
+        dropdown.set_items(
+            [
+                Item::new("a", "", "1"),
+                Item::new("c", "", "2"),
+                Item::new("d ├ e", "", "2"),
+            ]
+            .into_iter()
+            .map(|item| item.into())
+            .collect(),
+        );
+        let render = dropdown.render();
+        let layout = render.quickfix_layout.unwrap();
+        assert_eq!(layout.section_count(), 2);
+        assert_eq!(layout.value_count(), 3);
+        let mut parser = tree_sitter::Parser::new();
+        parser
+            .set_language(&tree_sitter_quickfix::language())
+            .unwrap();
+        let tree = parser.parse(&render.content, None).unwrap();
+        assert_eq!(
+            tree_sitter_quickfix::SectionOutline::from_layout(&layout),
+            tree_sitter_quickfix::SectionOutline::new(&tree)
+        );
+
+        dropdown.set_items(vec!["a".to_string().into()]);
+        assert_eq!(dropdown.render().quickfix_layout, None);
+    }
+
     #[test]
     fn test_dropdown_without_group() -> anyhow::Result<()> {
         let mut dropdown = Dropdown::new(DropdownConfig {
@@ -997,16 +1403,97 @@ mod test_dropdown {
             .collect_vec();
         indices == order
     }
+
+    #[test]
+    fn moving_up_and_down_should_jump_between_groups() {
+        use crate::components::editor::Movement::{Down, Up};
+        let mut dropdown = Dropdown::new(DropdownConfig {
+            title: "test".to_string(),
+        });
+        dropdown.set_items(
+            [
+                Item::new("a1", "", "a"),
+                Item::new("a2", "", "a"),
+                Item::new("b1", "", "b"),
+                Item::new("c1", "", "c"),
+                Item::new("c2", "", "c"),
+            ]
+            .into_iter()
+            .map(|item| item.into())
+            .collect(),
+        );
+        let mut move_and_get_index = |movement| {
+            dropdown.apply_movement(movement);
+            dropdown.current_item_index()
+        };
+        assert_eq!(
+            [Down, Down, Down, Up, Up, Up].map(&mut move_and_get_index),
+            [2, 3, 3, 2, 0, 0]
+        );
+    }
+
+    #[quickcheck]
+    fn group_lookup_by_binary_search_should_match_linear_search(items: DropdownItems) -> bool {
+        let mut dropdown = Dropdown::new(DropdownConfig {
+            title: "hello".to_string(),
+        });
+        dropdown.set_items(items.0);
+        let expected = dropdown
+            .filtered_item_groups
+            .iter()
+            .enumerate()
+            .flat_map(|(group_index, group)| {
+                group
+                    .items
+                    .iter()
+                    .map(move |item| (group_index, item.item.clone()))
+            })
+            .collect_vec();
+        let actual = (0..expected.len())
+            .map(|item_index| {
+                Some((
+                    dropdown.get_item_group_index(item_index)?,
+                    dropdown.get_item_by_index(item_index)?,
+                ))
+            })
+            .collect::<Option<Vec<_>>>();
+        actual == Some(expected.clone())
+            && dropdown.get_item_group_index(expected.len()).is_none()
+            && dropdown.get_item_by_index(expected.len()).is_none()
+    }
 }
 
 #[derive(Clone, Debug, PartialEq, Eq)]
 pub(crate) struct DropdownRender {
     pub(crate) content: String,
+    /// Identifies `content`
+    pub(crate) revision: usize,
+    /// How `content` differs from the render of revision
+    /// `edit.base_revision`, so that an editor showing that render only has
+    /// to apply this, see [`Buffer::update_from_render`]
+    ///
+    /// [`Buffer::update_from_render`]: crate::buffer::Buffer::update_from_render
+    pub(crate) edit: Option<ContentEdit>,
+    /// Describes where the sections of `content` are, so that the quickfix
+    /// list does not have to scan `content` for them. `None` if the items
+    /// are not grouped.
+    pub(crate) quickfix_layout: Option<QuickfixLayout>,
     pub(crate) decorations: Vec<Decoration>,
     pub(crate) title: String,
     pub(crate) highlight_line_index: usize,
     pub(crate) info: Option<Info>,
 }
+
+/// The change of the content of a dropdown from one revision to the next, see
+/// [`DropdownRender::edit`]
+#[derive(Clone, Debug, PartialEq, Eq)]
+pub(crate) struct ContentEdit {
+    pub(crate) base_revision: usize,
+    /// The bytes of the content of `base_revision` that are replaced by `text`
+    pub(crate) range: Range<usize>,
+    pub(crate) text: String,
+}
+
 #[derive(Debug, Clone, PartialEq)]
 struct FilteredDropdownItem {
     item_index: u32,
@@ -1,6 +1,6 @@
 use crate::{
     app::{Dispatches, RequestParams},
-    buffer::Line,
+    buffer::{ChangedLines, Line},
     char_index_range::CharIndexRange,
     clipboard::CopiedTexts,
     context::{Context, GlobalMode, LocalSearchConfigMode, Search},
@@ -482,10 +482,12 @@ impl Editor {
         context: &mut Context,
         render: &DropdownRender,
     ) -> anyhow::Result<Dispatches> {
+        // The dropdown is rendered again on every keystroke of filtering, so
+        // only the groups that changed are replaced and reparsed
+        self.set_content_from_render(render)?;
         self.apply_dispatches(
             context,
             [
-                SetContent(render.content.clone()),
                 SetDecorations(render.decorations.clone()),
                 SelectLineAt(render.highlight_line_index),
             ]
@@ -626,6 +628,7 @@ impl Editor {
             self.align_cursor_to_center();
             self.current_view_alignment = None;
         }
+        self.parse_visible_lines()
     }
 
     pub(crate) fn align_cursor_to_bottom(&mut self) {
@@ -635,10 +638,12 @@ impl Editor {
                 .saturating_sub(1)
                 .saturating_sub(WINDOW_TITLE_HEIGHT as u16),
         );
+        self.parse_visible_lines()
     }
 
     pub(crate) fn align_cursor_to_top(&mut self) {
         self.scroll_offset = self.cursor_row();
+        self.parse_visible_lines()
     }
 
     fn align_cursor_to_center(&mut self) {
@@ -1617,6 +1622,7 @@ impl Editor {
             Direction::Start => self.scroll_offset.saturating_sub(scroll_height as u16),
             Direction::End => self.scroll_offset.saturating_add(scroll_height as u16),
         };
+        self.parse_visible_lines()
     }
 
     pub(crate) fn backspace(&mut self) -> anyhow::Result<Dispatches> {
@@ -1774,6 +1780,51 @@ impl Editor {
         self.buffer.borrow_mut().update(s)
     }
 
+    /// Like `set_content`, see [`Buffer::update_from_render`]
+    fn set_content_from_render(&mut self, render: &DropdownRender) -> anyhow::Result<()> {
+        self.buffer.borrow_mut().update_from_render(
+            &render.content,
+            render.revision,
+            render.edit.as_ref(),
+        );
+        self.clamp()
+    }
+
+    /// Like `set_content`, but only the lines around the viewport are parsed,
+    /// see [`Buffer::update_lazily`]
+    pub(crate) fn set_content_lazily(
+        &mut self,
+        s: &str,
+        layout: Option<&tree_sitter_quickfix::QuickfixLayout>,
+        cache: &mut tree_sitter_quickfix::TreeCache,
+    ) -> anyhow::Result<Option<ChangedLines>> {
+        let start = self.scroll_offset as usize;
+        let visible_lines = start..start + self.rectangle.height as usize;
+        let changed = self
+            .buffer
+            .borrow_mut()
+            .update_lazily(s, layout, visible_lines, cache);
+        self.clamp()?;
+        Ok(changed)
+    }
+
+    fn parse_visible_lines(&mut self) {
+        let visible_line_range = self.visible_line_range();
+        self.buffer
+            .borrow_mut()
+            .parse_visible_lines(visible_line_range)
+    }
+
+    /// See [`Buffer::has_pending_parse`]
+    pub(crate) fn has_pending_parse(&self) -> bool {
+        self.buffer.borrow().has_pending_parse()
+    }
+
+    /// See [`Buffer::resume_parse`]
+    pub(crate) fn resume_parse(&mut self) -> tree_sitter_quickfix::ViewportProgress {
+        self.buffer.borrow_mut().resume_parse()
+    }
+
     fn scroll(&mut self, direction: Direction, scroll_height: usize) -> anyhow::Result<Dispatches> {
         let dispatch = self.update_selection_set(
             self.selection_set
@@ -2106,6 +2157,15 @@ impl Editor {
         self.buffer.borrow_mut().set_decorations(decorations)
     }
 
+    /// See [`Buffer::redecorate`]
+    pub(crate) fn redecorate(
+        &mut self,
+        changed: &ChangedLines,
+        decorations: Vec<super::suggestive_editor::Decoration>,
+    ) {
+        self.buffer.borrow_mut().redecorate(changed, decorations)
+    }
+
     fn half_page_height(&self) -> usize {
         (self.dimension().height / 2) as usize
     }
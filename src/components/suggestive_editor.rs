@@ -958,6 +958,14 @@ impl Decoration {
         }
     }
 
+    /// See [`SelectionRange::move_to_line`]
+    pub(crate) fn move_to_line(self, line: usize) -> Decoration {
+        Decoration {
+            selection_range: self.selection_range.move_to_line(line),
+            ..self
+        }
+    }
+
     pub(crate) fn move_left(self, count: usize) -> Decoration {
         Decoration {
             selection_range: self.selection_range.move_left(count),
@@ -21,6 +21,10 @@ use itertools::Itertools;
 use nary_tree::NodeId;
 use shared::canonicalized_path::CanonicalizedPath;
 use std::{cell::RefCell, rc::Rc};
+use tree_sitter_quickfix::{TreeCache, ViewportProgress};
+
+/// Enough for switching between diagnostics, references and a few searches
+const QUICKFIX_TREE_CACHE_CAPACITY: usize = 8;
 
 /// The layout of the app is split into multiple sections: the main panel, info panel, quickfix
 /// lists, prompts, and etc.
@@ -30,6 +34,8 @@ pub(crate) struct Layout {
     background_suggestive_editors: IndexMap<CanonicalizedPath, Rc<RefCell<SuggestiveEditor>>>,
     background_file_explorer: Rc<RefCell<FileExplorer>>,
     background_quickfix_list: Option<Rc<RefCell<Editor>>>,
+    /// Trees of recently shown quickfix lists
+    quickfix_tree_cache: TreeCache,
 
     rectangles: Vec<Rectangle>,
     borders: Vec<Border>,
@@ -48,6 +54,7 @@ impl Layout {
         let tree = UiTree::new();
         Ok(Layout {
             background_quickfix_list: None,
+            quickfix_tree_cache: TreeCache::new(QUICKFIX_TREE_CACHE_CAPACITY),
             background_suggestive_editors: IndexMap::new(),
             background_file_explorer: Rc::new(RefCell::new(FileExplorer::new(working_directory)?)),
             rectangles,
@@ -377,7 +384,9 @@ impl Layout {
         &mut self,
         quickfix_list: QuickfixList,
     ) -> anyhow::Result<Dispatches> {
-        let render = quickfix_list.render();
+        // Only the decorations of the lines that changed are computed, after
+        // the content is set
+        let render = quickfix_list.render_without_decorations();
         let editor = self.background_quickfix_list.get_or_insert_with(|| {
             Rc::new(RefCell::new(Editor::from_text(
                 Some(tree_sitter_quickfix::language()),
@@ -390,8 +399,23 @@ impl Layout {
 
         let dispatches = {
             let mut editor = editor.borrow_mut();
-            editor.set_content(&render.content)?;
-            editor.set_decorations(&render.decorations);
+            // Quickfix lists can have hundreds of thousands of entries, so
+            // only the part that is scrolled into view is parsed
+            let changed = editor.set_content_lazily(
+                &render.content,
+                render.quickfix_layout.as_ref(),
+                &mut self.quickfix_tree_cache,
+            )?;
+            // Quickfix lists are never filtered, so the decorations of a line
+            // depend on nothing but its content, and the ones of the lines
+            // that did not change are still valid
+            match changed {
+                Some(changed) => editor.redecorate(
+                    &changed,
+                    quickfix_list.decorations_in_lines(changed.lines()),
+                ),
+                None => editor.set_decorations(&quickfix_list.decorations()),
+            }
             editor.set_title("Quickfix list".to_string());
             editor.select_line_at(render.highlight_line_index)?
         };
@@ -401,6 +425,29 @@ impl Layout {
         Ok(dispatches)
     }
 
+    /// Whether the quickfix list ran out of its parse budget, see
+    /// [`Layout::resume_quickfix_parse`]
+    pub(crate) fn has_pending_quickfix_parse(&self) -> bool {
+        self.background_quickfix_list
+            .as_ref()
+            .map_or(false, |editor| editor.borrow().has_pending_parse())
+    }
+
+    /// Parse the quickfix list for one more budget. Showing another quickfix
+    /// list abandons the pending parse instead.
+    pub(crate) fn resume_quickfix_parse(&mut self) -> ViewportProgress {
+        self.background_quickfix_list
+            .as_ref()
+            .map_or(ViewportProgress::Unchanged, |editor| {
+                editor.borrow_mut().resume_parse()
+            })
+    }
+
+    #[cfg(test)]
+    pub(crate) fn quickfix_tree_cache(&self) -> &TreeCache {
+        &self.quickfix_tree_cache
+    }
+
     #[cfg(test)]
     pub(crate) fn get_dropdown_infos_count(&self) -> usize {
         self.tree.count_by_kind(ComponentKind::DropdownInfo)
@@ -448,13 +495,14 @@ impl Layout {
         self.background_file_explorer.borrow().content()
     }
 
+    /// The items of every buffer, one list per buffer, see [`QuickfixList::new`]
     pub(crate) fn get_quickfix_list_items(
         &self,
         source: &QuickfixListSource,
-    ) -> Vec<QuickfixListItem> {
+    ) -> Vec<Vec<QuickfixListItem>> {
         self.buffers()
             .into_iter()
-            .flat_map(|buffer| {
+            .map(|buffer| {
                 let buffer = buffer.borrow();
                 match source {
                     QuickfixListSource::Diagnostic(severity_range) => buffer
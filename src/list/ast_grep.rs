@@ -1,14 +1,11 @@
-use crate::{
-    quickfix_list::Location,
-    selection_mode::{AstGrep, ByteRange},
-};
+use crate::selection_mode::{AstGrep, ByteRange};
 
-use super::WalkBuilderConfig;
+use super::{FileMatches, WalkBuilderConfig};
 
 pub(crate) fn run(
     pattern: String,
     walk_builder_config: WalkBuilderConfig,
-) -> anyhow::Result<Vec<Location>> {
+) -> anyhow::Result<Vec<FileMatches>> {
     walk_builder_config.run_with_search(
         true,
         Box::new(move |buffer| {
@@ -1,11 +1,11 @@
-use crate::{quickfix_list::Location, selection_mode::CaseAgnostic};
+use crate::selection_mode::CaseAgnostic;
 
-use super::WalkBuilderConfig;
+use super::{FileMatches, WalkBuilderConfig};
 
 pub(crate) fn run(
     pattern: String,
     walk_builder_config: WalkBuilderConfig,
-) -> anyhow::Result<Vec<Location>> {
+) -> anyhow::Result<Vec<FileMatches>> {
     walk_builder_config.run_with_search(
         false,
         Box::new(move |buffer| {
@@ -9,7 +9,7 @@ use crate::{
 };
 use shared::canonicalized_path::CanonicalizedPath;
 
-use super::WalkBuilderConfig;
+use super::{FileMatches, WalkBuilderConfig};
 
 #[derive(Clone, Debug, PartialEq, Eq, Copy)]
 pub(crate) struct RegexConfig {
@@ -60,50 +60,51 @@ pub(crate) fn run(
     pattern: &str,
     walk_builder_config: WalkBuilderConfig,
     grep_config: RegexConfig,
-) -> anyhow::Result<Vec<Location>> {
+) -> anyhow::Result<Vec<FileMatches>> {
     let pattern = get_regex(pattern, grep_config)?.as_str().to_string();
     let matcher = RegexMatcher::new_line_matcher(&pattern)?;
     let regex = Regex::new(&pattern)?;
 
-    Ok(walk_builder_config
-        .run(Box::new(move |path, sender| {
-            let path = path.try_into()?;
-            let buffer = Buffer::from_path(&path, false)?;
-            // Tree-sitter should be disabled whenever possible during
-            // global search, because it will slow down the operation tremendously
-            debug_assert!(buffer.tree().is_none());
-            let mut searcher = SearcherBuilder::new().build();
-            searcher.search_path(
-                &matcher,
-                path.clone(),
-                sinks::UTF8(|line_number, line| {
-                    if let Ok(location) = to_location(
-                        &buffer,
-                        path.clone(),
-                        line_number as usize,
-                        line,
-                        regex.clone(),
-                    ) {
-                        let _ = sender.send(location).map_err(|error| {
-                            log::error!("sender.send {:?}", error);
-                        });
-                    }
-                    Ok(true)
-                }),
-            )?;
-            Ok(())
-        }))?
-        .into_iter()
-        .flatten()
-        .collect())
+    walk_builder_config.run_grouped(Box::new(move |path| {
+        // Most files do not match, so every file is read only once, and the
+        // ones that do not match are never canonicalized or turned into a
+        // buffer
+        let bytes = std::fs::read(&path)?;
+        let mut lines = Vec::new();
+        SearcherBuilder::new().build().search_slice(
+            &matcher,
+            &bytes,
+            // Invalid UTF-8 is replaced, so that a stray byte does not turn
+            // the matches of a file into an error
+            sinks::Lossy(|line_number, line| {
+                lines.push((line_number as usize, line.to_string()));
+                Ok(true)
+            }),
+        )?;
+        if lines.is_empty() {
+            return Ok(None);
+        }
+        let path: CanonicalizedPath = path.try_into()?;
+        // Tree-sitter should be disabled whenever possible during
+        // global search, because it will slow down the operation tremendously
+        let buffer = Buffer::new(None, &String::from_utf8_lossy(&bytes));
+        let locations = lines
+            .iter()
+            .filter_map(|(line_number, line)| {
+                to_location(&buffer, &path, *line_number, line, &regex).ok()
+            })
+            .flatten()
+            .collect();
+        Ok(Some(FileMatches { path, locations }))
+    }))
 }
 
 fn to_location(
     buffer: &Buffer,
-    path: CanonicalizedPath,
+    path: &CanonicalizedPath,
     line_number: usize,
     line: &str,
-    regex: Regex,
+    regex: &Regex,
 ) -> anyhow::Result<Vec<Location>> {
     let start_byte = buffer.line_to_byte(line_number.saturating_sub(1))?;
     let locations = regex
@@ -121,3 +122,49 @@ fn to_location(
 
     Ok(locations)
 }
+
+#[cfg(test)]
+mod test_grep {
+    use globset::Glob;
+    use itertools::Itertools;
+
+    use super::{run, RegexConfig};
+    use crate::{list::WalkBuilderConfig, position::Position};
+
+    #[test]
+    fn matches_should_be_grouped_by_file_in_order() -> anyhow::Result<()> {
+        let config = WalkBuilderConfig {
+            root: "./tests/mock_repos/rust1".into(),
+            include: Some(Glob::new("src/*.rs")?),
+            exclude: None,
+        };
+        let locations = run("foo", config, RegexConfig::default())?;
+        assert!(locations.windows(2).all(|pair| pair[0] <= pair[1]));
+        assert_eq!(
+            locations
+                .iter()
+                .map(|location| location.path.to_path_buf().file_name().unwrap().to_owned())
+                .dedup_with_count()
+                .map(|(count, name)| (count, name.to_string_lossy().to_string()))
+                .collect_vec(),
+            [(4, "foo.rs".to_string()), (3, "main.rs".to_string())]
+        );
+        Ok(())
+    }
+
+    #[test]
+    fn files_with_invalid_utf8_should_be_searched() -> anyhow::Result<()> {
+        let dir = tempfile::tempdir()?;
+        std::fs::write(dir.path().join("latin1.txt"), b"caf\xe9\nfoo bar\n")?;
+        let config = WalkBuilderConfig {
+            root: dir.path().to_path_buf(),
+            include: None,
+            exclude: None,
+        };
+        let locations = run("bar", config, RegexConfig::default())?;
+        assert_eq!(locations.len(), 1);
+        // The invalid byte of the first line does not shift the match
+        assert_eq!(locations[0].range, Position::new(1, 4)..Position::new(1, 7));
+        Ok(())
+    }
+}
@@ -18,43 +18,71 @@ pub(crate) struct WalkBuilderConfig {
     pub(crate) exclude: Option<Glob>,
 }
 
+/// The matches of one file.
+///
+/// Search workers send one of these per file instead of one message per
+/// match, so that the matches of a file arrive together, rather than
+/// interleaved with the matches of the files searched on other threads.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub(crate) struct FileMatches {
+    pub(crate) path: CanonicalizedPath,
+    pub(crate) locations: Vec<Location>,
+}
+
 type SearchFn = dyn Fn(&Buffer) -> anyhow::Result<Vec<ByteRange>> + Send + Sync;
+type GroupedSearchFn = dyn Fn(PathBuf) -> anyhow::Result<Option<FileMatches>> + Send + Sync;
 impl WalkBuilderConfig {
     pub(crate) fn run_with_search(
         self,
         enable_tree_sitter: bool,
         f: Box<SearchFn>,
-    ) -> anyhow::Result<Vec<Location>> {
-        self.run(Box::new(move |path, sender| {
-            let path = path.try_into()?;
+    ) -> anyhow::Result<Vec<FileMatches>> {
+        self.run_grouped(Box::new(move |path| {
+            let path: CanonicalizedPath = path.try_into()?;
             let buffer = Buffer::from_path(&path, enable_tree_sitter)?;
             // Tree-sitter should be disabled whenever possible during
             // global search, because it will slow down the operation tremendously
             if !enable_tree_sitter {
                 debug_assert!(buffer.tree().is_none())
             }
-            let _ = f(&buffer)?
+            let locations = f(&buffer)?
                 .into_iter()
-                .flat_map(move |node_match| -> anyhow::Result<_> {
+                .filter_map(|node_match| {
                     let range = node_match.range();
-                    let range = buffer.byte_to_position(range.start)?
-                        ..buffer.byte_to_position(range.end)?;
-
-                    let _ = sender
-                        .send(Location {
-                            path: path.clone(),
-                            range,
-                        })
-                        .map_err(|error| {
-                            log::error!("sender.send {:?}", error);
-                        });
-
-                    Ok(())
+                    let range = buffer.byte_to_position(range.start).ok()?
+                        ..buffer.byte_to_position(range.end).ok()?;
+                    Some(Location {
+                        path: path.clone(),
+                        range,
+                    })
                 })
-                .collect::<Vec<_>>();
-            Ok(())
+                .collect();
+            Ok(Some(FileMatches { path, locations }))
         }))
     }
+
+    /// Like [`WalkBuilderConfig::run`], for searches that find the matches
+    /// of a file all at once.
+    ///
+    /// `f` runs on the threads of the walk, which also sort the matches of
+    /// their files, so that only the files are left to be sorted here. The
+    /// result is in the order of the quickfix list: the files with matches,
+    /// sorted by path, each with its matches sorted by position, so that
+    /// [`QuickfixListType::Files`](crate::quickfix_list::QuickfixListType::Files)
+    /// can take them as they are.
+    pub(crate) fn run_grouped(self, f: Box<GroupedSearchFn>) -> anyhow::Result<Vec<FileMatches>> {
+        let mut files = self.run(Box::new(move |path, sender| {
+            if let Some(mut matches) = f(path)? {
+                if !matches.locations.is_empty() {
+                    matches.locations.sort_unstable();
+                    sender.send(matches)?
+                }
+            }
+            Ok(())
+        }))?;
+        files.sort_unstable_by(|a, b| a.path.cmp(&b.path));
+        Ok(files)
+    }
     pub(crate) fn run<T: Send>(
         self,
         f: Box<dyn Fn(PathBuf, Sender<T>) -> anyhow::Result<()> + Send + Sync>,
@@ -1,4 +1,4 @@
-use std::{cell::RefCell, ops::Range, rc::Rc};
+use std::{cell::RefCell, collections::HashMap, ops::Range, rc::Rc};
 
 use itertools::Itertools;
 use lsp_types::DiagnosticSeverity;
@@ -9,14 +9,18 @@ use crate::{
     components::{
         dropdown::{Dropdown, DropdownConfig, DropdownItem},
         editor::Movement,
-        suggestive_editor::Info,
+        suggestive_editor::{Decoration, Info},
     },
+    list::FileMatches,
     position::Position,
 };
 use shared::canonicalized_path::CanonicalizedPath;
 
 impl QuickfixListItem {
-    fn into_dropdown_item(self: QuickfixListItem, buffers: &[Rc<RefCell<Buffer>>]) -> DropdownItem {
+    fn into_dropdown_item(
+        self: QuickfixListItem,
+        buffers: &HashMap<CanonicalizedPath, Rc<RefCell<Buffer>>>,
+    ) -> DropdownItem {
         let location = self.location();
         let Position { line, column } = location.range.start;
         DropdownItem::new({
@@ -60,32 +64,53 @@ pub(crate) struct QuickfixList {
 }
 
 impl QuickfixList {
+    /// `files` are the items of each file, e.g. of each buffer, so that only
+    /// the items of one file at a time are sorted and merged, and only the
+    /// files are sorted by path. Global searches already sort the matches of
+    /// every file on their worker threads, which makes sorting them again
+    /// cheap.
     pub(crate) fn new(
-        items: Vec<QuickfixListItem>,
+        mut files: Vec<Vec<QuickfixListItem>>,
         buffers: Vec<Rc<RefCell<Buffer>>>,
     ) -> QuickfixList {
         let mut dropdown = Dropdown::new(DropdownConfig {
             title: "Quickfix".to_string(),
         });
+        files.retain(|items| !items.is_empty());
+        files.sort_by(|a, b| a[0].location.path.cmp(&b[0].location.path));
         // Merge items of same locations
-        let items = items
+        let items = files
             .into_iter()
-            // Sort the items by location
-            .sorted_by_key(|item| item.location.clone())
-            .group_by(|item| item.location.clone())
-            .into_iter()
-            .map(|(location, items)| QuickfixListItem {
-                location,
-                info: items
+            .flat_map(|mut items| {
+                // Sort the items by location
+                items.sort();
+                items
+                    .into_iter()
+                    .group_by(|item| item.location.clone())
                     .into_iter()
-                    .flat_map(|item| item.info)
-                    .reduce(Info::join),
+                    .map(|(location, items)| QuickfixListItem {
+                        location,
+                        info: items
+                            .into_iter()
+                            .flat_map(|item| item.info)
+                            .reduce(Info::join),
+                    })
+                    .collect_vec()
             })
             .collect_vec();
+        // Global searches can have matches in thousands of files, so the
+        // buffer of every item is looked up by path instead of one by one
+        let mut buffers_by_path = HashMap::new();
+        for buffer in buffers {
+            let path = buffer.borrow().path();
+            if let Some(path) = path {
+                buffers_by_path.entry(path).or_insert(buffer);
+            }
+        }
         dropdown.set_items(
             items
                 .iter()
-                .map(|item| item.to_owned().into_dropdown_item(&buffers))
+                .map(|item| item.to_owned().into_dropdown_item(&buffers_by_path))
                 .collect(),
         );
 
@@ -105,6 +130,20 @@ impl QuickfixList {
         self.dropdown.render()
     }
 
+    /// See [`Dropdown::render_without_decorations`]
+    pub(crate) fn render_without_decorations(&self) -> crate::components::dropdown::DropdownRender {
+        self.dropdown.render_without_decorations()
+    }
+
+    pub(crate) fn decorations(&self) -> Vec<Decoration> {
+        self.dropdown.decorations()
+    }
+
+    /// See [`Dropdown::decorations_in_lines`]
+    pub(crate) fn decorations_in_lines(&self, lines: &[Range<usize>]) -> Vec<Decoration> {
+        self.dropdown.decorations_in_lines(lines)
+    }
+
     /// Returns the current item index after `movement` is applied
     pub(crate) fn get_item(&mut self, movement: Movement) -> Option<(usize, Dispatches)> {
         self.dropdown.apply_movement(movement);
@@ -173,24 +212,13 @@ pub(crate) struct Location {
 }
 
 impl Location {
-    fn read_from_buffers(&self, buffers: &[Rc<RefCell<Buffer>>]) -> Option<String> {
-        buffers
-            .iter()
-            .find(|buffer| {
-                if let Some(path) = buffer.borrow().path() {
-                    path == self.path
-                } else {
-                    false
-                }
-            })
-            .and_then(|buffer| {
-                Some(
-                    buffer
-                        .borrow()
-                        .get_line_by_line_index(self.range.start.line)?
-                        .to_string(),
-                )
-            })
+    fn read_from_buffers(
+        &self,
+        buffers: &HashMap<CanonicalizedPath, Rc<RefCell<Buffer>>>,
+    ) -> Option<String> {
+        let buffer = buffers.get(&self.path)?.borrow();
+        let line = buffer.get_line_by_line_index(self.range.start.line)?;
+        Some(line.to_string())
     }
 }
 
@@ -229,6 +257,8 @@ impl Ord for Location {
 pub(crate) enum QuickfixListType {
     Diagnostic(DiagnosticSeverityRange),
     Items(Vec<QuickfixListItem>),
+    /// The matches of a global search, already grouped by file
+    Files(Vec<FileMatches>),
     Bookmark,
 }
 
@@ -295,8 +325,10 @@ mod test_quickfix_list {
             },
             info: None,
         };
-        let quickfix_list =
-            QuickfixList::new(vec![foo.clone(), bar.clone(), spam.clone()], Vec::new());
+        let quickfix_list = QuickfixList::new(
+            vec![vec![bar.clone()], vec![foo.clone(), spam.clone()]],
+            Vec::new(),
+        );
         assert_eq!(quickfix_list.items(), vec![spam, foo, bar])
     }
 
@@ -320,7 +352,7 @@ mod test_quickfix_list {
         ]
         .to_vec();
 
-        let quickfix_list = QuickfixList::new(items, Vec::new());
+        let quickfix_list = QuickfixList::new(vec![items], Vec::new());
 
         assert_eq!(
             quickfix_list.items(),
@@ -23,6 +23,34 @@ impl SelectionRange {
         }
     }
 
+    /// The line that a position range starts on, or `None` for a byte range
+    pub(crate) fn start_line(&self) -> Option<usize> {
+        match self {
+            SelectionRange::Byte(_) => None,
+            SelectionRange::Position(range) => Some(range.start.line),
+        }
+    }
+
+    /// Move a position range along with its line, when lines were inserted
+    /// or removed above it
+    pub(crate) fn move_to_line(&self, line: usize) -> SelectionRange {
+        match self {
+            SelectionRange::Byte(_) => self.clone(),
+            SelectionRange::Position(range) => {
+                let end_line = line + range.end.line.saturating_sub(range.start.line);
+                Self::Position(
+                    Position {
+                        line,
+                        ..range.start
+                    }..Position {
+                        line: end_line,
+                        ..range.end
+                    },
+                )
+            }
+        }
+    }
+
     pub(crate) fn move_left(&self, count: usize) -> SelectionRange {
         match self {
             SelectionRange::Byte(_) => todo!(),
@@ -106,6 +106,7 @@ pub(crate) enum ExpectKind {
     CurrentComponentPath(Option<CanonicalizedPath>),
     OpenedFilesCount(usize),
     QuickfixListInfo(&'static str),
+    QuickfixTreeCacheHit(bool),
     ComponentsOrder(Vec<ComponentKind>),
     CurrentComponentTitle(&'static str),
     CurrentSelectionMode(SelectionMode),
@@ -269,6 +270,9 @@ impl ExpectKind {
             DropdownInfosCount(expected) => {
                 contextualize(app.get_dropdown_infos_count(), *expected)
             }
+            QuickfixTreeCacheHit(expected) => {
+                contextualize(app.quickfix_tree_cache_hits() > 0, *expected)
+            }
             QuickfixListCurrentLine(expected) => {
                 let component = app
                     .get_component_by_kind(ComponentKind::QuickfixList)
@@ -1211,6 +1215,8 @@ foo a // Line 10
             Editor(MoveSelection(Next)),
             Expect(ComponentCount(2)),
             Expect(QuickfixListCurrentLine("└─ 10:1  foo a // Line 10")),
+            // Moving to another item renders the same list again
+            Expect(QuickfixTreeCacheHit(true)),
             Expect(CurrentLine("foo a // Line 10")),
             Expect(CurrentSelectedTexts(&["foo"])),
             Editor(MoveSelection(Next)),
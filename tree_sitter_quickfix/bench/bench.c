@@ -0,0 +1,228 @@
+// Native benchmark harness for the quickfix grammar.
+//
+// Generates the same synthetic documents as `benches/corpus/mod.rs` and
+// reports, for full parses, incremental edits and re-parses, the throughput in
+// MB/s and nodes/s. The peak RSS is reported once per shape. Every shape is
+// benchmarked in a child process of its own, because the peak RSS of a
+// process cannot be reset, and would otherwise be the one of the largest
+// shape so far.
+//
+// Build and run with `just bench-native` (requires libtree-sitter).
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <tree_sitter/api.h>
+
+const TSLanguage *tree_sitter_quickfix(void);
+
+typedef struct {
+  size_t lines;
+  size_t fan_out;
+  size_t line_length;
+} Shape;
+
+static const Shape SHAPES[] = {
+    {1000, 10, 80},      {100000, 1, 80},  {100000, 10, 80},
+    {100000, 100, 200},  {1000000, 10, 80},
+};
+
+#define ITERATIONS 10
+
+typedef struct {
+  char *data;
+  size_t length;
+  size_t capacity;
+} Buffer;
+
+static void buffer_push(Buffer *buffer, const char *data, size_t length) {
+  if (buffer->length + length > buffer->capacity) {
+    buffer->capacity = (buffer->capacity + length) * 2;
+    buffer->data = realloc(buffer->data, buffer->capacity);
+  }
+  memcpy(buffer->data + buffer->length, data, length);
+  buffer->length += length;
+}
+
+static uint64_t lcg_next(uint64_t *state) {
+  *state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+  return *state >> 33;
+}
+
+static Buffer generate(Shape shape) {
+  Buffer buffer = {0};
+  uint64_t random = shape.lines;
+  size_t section_lines = shape.fan_out + 2;
+  size_t section_count = shape.lines / section_lines;
+  if (section_count == 0) section_count = 1;
+  char line[256];
+  for (size_t section = 0; section < section_count; section++) {
+    if (section > 0) buffer_push(&buffer, "\n\n", 2);
+    int length = snprintf(line, sizeof(line), "■┬ src/module_%zu/file_%zu.rs\n",
+                          section % 97, section);
+    buffer_push(&buffer, line, length);
+    for (size_t value = 0; value < shape.fan_out; value++) {
+      const char *marker = value + 1 == shape.fan_out ? "└" : "├";
+      int prefix_length =
+          snprintf(line, sizeof(line), " %s %llu:%zu  ", marker,
+                   (unsigned long long)(lcg_next(&random) % 5000 + 1), value + 1);
+      buffer_push(&buffer, line, prefix_length);
+      for (size_t i = 0; i + prefix_length < shape.line_length; i++) {
+        char byte = 'a' + (char)((lcg_next(&random) + i) % 26);
+        buffer_push(&buffer, i % 7 == 6 ? " " : &byte, 1);
+      }
+      if (value + 1 != shape.fan_out) buffer_push(&buffer, "\n", 1);
+    }
+  }
+  return buffer;
+}
+
+static double now_seconds(void) {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+static uint64_t node_count(TSTree *tree) {
+  TSTreeCursor cursor = ts_tree_cursor_new(ts_tree_root_node(tree));
+  uint64_t count = 1;
+  for (;;) {
+    if (ts_tree_cursor_goto_first_child(&cursor) ||
+        ts_tree_cursor_goto_next_sibling(&cursor)) {
+      count++;
+      continue;
+    }
+    for (;;) {
+      if (!ts_tree_cursor_goto_parent(&cursor)) {
+        ts_tree_cursor_delete(&cursor);
+        return count;
+      }
+      if (ts_tree_cursor_goto_next_sibling(&cursor)) {
+        count++;
+        break;
+      }
+    }
+  }
+}
+
+static long peak_rss_kb(void) {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+static void report(const char *name, const Shape *shape, size_t bytes,
+                   uint64_t nodes, double seconds) {
+  double per_iteration = seconds / ITERATIONS;
+  printf("%-16s lines=%-8zu fan_out=%-4zu line_length=%-4zu %10.3f ms %9.2f MB/s "
+         "%12.0f nodes/s\n",
+         name, shape->lines, shape->fan_out, shape->line_length,
+         per_iteration * 1e3, bytes / per_iteration / 1e6, nodes / per_iteration);
+}
+
+static int is_lowercase(char byte) { return byte >= 'a' && byte <= 'z'; }
+
+// Replace the first lowercase letter from the middle of the document on,
+// which keeps it well-formed, and describe that as a `TSInputEdit`. Returns 0
+// if the second half of the document has no lowercase letter.
+static int middle_edit(Buffer *buffer, TSInputEdit *edit) {
+  size_t byte = buffer->length / 2;
+  while (byte < buffer->length && !is_lowercase(buffer->data[byte])) byte++;
+  if (byte == buffer->length) return 0;
+  buffer->data[byte] = buffer->data[byte] == 'x' ? 'y' : 'x';
+  TSPoint point = {0, 0};
+  for (size_t i = 0; i < byte; i++) {
+    if (buffer->data[i] == '\n') {
+      point.row++;
+      point.column = 0;
+    } else {
+      point.column++;
+    }
+  }
+  TSPoint end_point = {point.row, point.column + 1};
+  *edit = (TSInputEdit){
+      .start_byte = byte,
+      .old_end_byte = byte + 1,
+      .new_end_byte = byte + 1,
+      .start_point = point,
+      .old_end_point = end_point,
+      .new_end_point = end_point,
+  };
+  return 1;
+}
+
+static int bench_shape(const Shape *shape) {
+  TSParser *parser = ts_parser_new();
+  ts_parser_set_language(parser, tree_sitter_quickfix());
+  Buffer buffer = generate(*shape);
+
+  TSTree *tree = ts_parser_parse_string(parser, NULL, buffer.data, buffer.length);
+  if (ts_node_has_error(ts_tree_root_node(tree))) {
+    fprintf(stderr, "generated document has errors\n");
+    return 1;
+  }
+  uint64_t nodes = node_count(tree);
+
+  double start = now_seconds();
+  for (int i = 0; i < ITERATIONS; i++) {
+    ts_tree_delete(ts_parser_parse_string(parser, NULL, buffer.data, buffer.length));
+  }
+  report("full", shape, buffer.length, nodes, now_seconds() - start);
+
+  start = now_seconds();
+  for (int i = 0; i < ITERATIONS; i++) {
+    ts_tree_delete(ts_parser_parse_string(parser, tree, buffer.data, buffer.length));
+  }
+  report("reparse", shape, buffer.length, nodes, now_seconds() - start);
+
+  double elapsed = 0;
+  for (int i = 0; i < ITERATIONS; i++) {
+    TSInputEdit edit;
+    if (!middle_edit(&buffer, &edit)) {
+      fprintf(stderr, "generated document has no letter to edit\n");
+      return 1;
+    }
+    ts_tree_edit(tree, &edit);
+    start = now_seconds();
+    TSTree *new_tree =
+        ts_parser_parse_string(parser, tree, buffer.data, buffer.length);
+    elapsed += now_seconds() - start;
+    ts_tree_delete(tree);
+    tree = new_tree;
+  }
+  report("incremental_edit", shape, buffer.length, nodes, elapsed);
+
+  printf("%-16s lines=%-8zu %zu bytes, %llu nodes, peak RSS %ld kB\n\n",
+         "summary", shape->lines, buffer.length, (unsigned long long)nodes,
+         peak_rss_kb());
+  ts_tree_delete(tree);
+  free(buffer.data);
+  ts_parser_delete(parser);
+  return 0;
+}
+
+int main(void) {
+  for (size_t s = 0; s < sizeof(SHAPES) / sizeof(SHAPES[0]); s++) {
+    // Flush before forking, so that the child does not print it again
+    fflush(stdout);
+    pid_t child = fork();
+    if (child < 0) {
+      perror("fork");
+      return 1;
+    }
+    if (child == 0) exit(bench_shape(&SHAPES[s]));
+    int status;
+    if (waitpid(child, &status, 0) < 0 || !WIFEXITED(status) ||
+        WEXITSTATUS(status) != 0) {
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,96 @@
+// Compares the WebAssembly build of the grammar, loaded into web-tree-sitter,
+// with the native addon, on the same synthetic documents as `bench.c`.
+//
+// Reports the time of a full parse and the throughput in MB/s for both. The
+// native addon reads the bytes of a `Buffer` in place, while web-tree-sitter
+// copies the JS string into the memory of the module first, which is part of
+// what a Web Worker pays too.
+//
+// Run with `just bench-wasm`.
+
+const path = require("path");
+const Parser = require("web-tree-sitter");
+const native = require("../bindings/node");
+const wasm = require("../bindings/wasm");
+
+const SHAPES = [
+  { lines: 1000, fanOut: 10, lineLength: 80 },
+  { lines: 100000, fanOut: 1, lineLength: 80 },
+  { lines: 100000, fanOut: 10, lineLength: 80 },
+  { lines: 100000, fanOut: 100, lineLength: 200 },
+  { lines: 1000000, fanOut: 10, lineLength: 80 },
+];
+
+const ITERATIONS = 10;
+
+// The generator of `bench.c`, ported as is so that both benchmarks parse the
+// same bytes
+function generate({ lines, fanOut, lineLength }) {
+  const MASK = (1n << 64n) - 1n;
+  let random = BigInt(lines);
+  const next = () => {
+    random = (random * 6364136223846793005n + 1442695040888963407n) & MASK;
+    return random >> 33n;
+  };
+  const sectionCount = Math.max(1, Math.floor(lines / (fanOut + 2)));
+  const parts = [];
+  for (let section = 0; section < sectionCount; section++) {
+    if (section > 0) parts.push("\n\n");
+    parts.push(`■┬ src/module_${section % 97}/file_${section}.rs\n`);
+    for (let value = 0; value < fanOut; value++) {
+      const marker = value + 1 === fanOut ? "└" : "├";
+      const prefix = ` ${marker} ${(next() % 5000n) + 1n}:${value + 1}  `;
+      const prefixLength = Buffer.byteLength(prefix);
+      parts.push(prefix);
+      let line = "";
+      for (let i = 0; i + prefixLength < lineLength; i++) {
+        const byte = String.fromCharCode(97 + Number((next() + BigInt(i)) % 26n));
+        line += i % 7 === 6 ? " " : byte;
+      }
+      parts.push(line);
+      if (value + 1 !== fanOut) parts.push("\n");
+    }
+  }
+  return parts.join("");
+}
+
+function measure(parse) {
+  const start = process.hrtime.bigint();
+  for (let i = 0; i < ITERATIONS; i++) parse();
+  return Number(process.hrtime.bigint() - start) / 1e6 / ITERATIONS;
+}
+
+function report(name, shape, bytes, ms) {
+  console.log(
+    `${name.padEnd(8)} lines=${String(shape.lines).padEnd(8)}` +
+      ` fan_out=${String(shape.fanOut).padEnd(4)}` +
+      ` line_length=${String(shape.lineLength).padEnd(4)}` +
+      ` ${ms.toFixed(3).padStart(10)} ms ${(bytes / ms / 1e3).toFixed(2).padStart(9)} MB/s`,
+  );
+}
+
+async function main() {
+  const language = await wasm.load(Parser, path.join(__dirname, "..", wasm.WASM_FILE));
+  const parser = new Parser();
+  parser.setLanguage(language);
+
+  for (const shape of SHAPES) {
+    const text = generate(shape);
+    const buffer = Buffer.from(text);
+
+    const tree = parser.parse(text);
+    if (tree.rootNode.hasError() || native.parseBuffer(buffer).hasError()) {
+      throw new Error("generated document has errors");
+    }
+    tree.delete();
+
+    report("native", shape, buffer.length, measure(() => native.parseBuffer(buffer)));
+    report("wasm", shape, buffer.length, measure(() => parser.parse(text).delete()));
+    console.log();
+  }
+}
+
+main().catch((error) => {
+  console.error(error);
+  process.exit(1);
+});
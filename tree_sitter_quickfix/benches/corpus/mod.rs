@@ -0,0 +1,100 @@
+//! Synthetic quickfix documents for benchmarking.
+//!
+//! The documents are deterministic, so that numbers are comparable between
+//! runs. `bench/bench.c` generates the same documents for the native harness.
+
+#[derive(Debug, Clone, Copy)]
+pub struct Shape {
+    /// Approximate total number of lines
+    pub lines: usize,
+    /// Number of values per section
+    pub fan_out: usize,
+    /// Approximate byte length of each value line
+    pub line_length: usize,
+}
+
+impl Shape {
+    pub fn id(&self) -> String {
+        format!(
+            "lines={}/fan_out={}/line_length={}",
+            self.lines, self.fan_out, self.line_length
+        )
+    }
+}
+
+pub const SHAPES: &[Shape] = &[
+    Shape {
+        lines: 1_000,
+        fan_out: 10,
+        line_length: 80,
+    },
+    Shape {
+        lines: 100_000,
+        fan_out: 1,
+        line_length: 80,
+    },
+    Shape {
+        lines: 100_000,
+        fan_out: 10,
+        line_length: 80,
+    },
+    Shape {
+        lines: 100_000,
+        fan_out: 100,
+        line_length: 200,
+    },
+    Shape {
+        lines: 1_000_000,
+        fan_out: 10,
+        line_length: 80,
+    },
+];
+
+/// A tiny linear congruential generator, good enough to vary line content
+struct Lcg(u64);
+
+impl Lcg {
+    fn next(&mut self) -> u64 {
+        self.0 = self
+            .0
+            .wrapping_mul(6364136223846793005)
+            .wrapping_add(1442695040888963407);
+        self.0 >> 33
+    }
+}
+
+pub fn generate(shape: Shape) -> String {
+    let mut random = Lcg(shape.lines as u64);
+    // header + values + blank separator
+    let section_lines = shape.fan_out + 2;
+    let section_count = (shape.lines / section_lines).max(1);
+    let mut result = String::with_capacity(shape.lines * (shape.line_length + 8));
+    for section in 0..section_count {
+        if section > 0 {
+            result.push_str("\n\n");
+        }
+        result.push_str(&format!(
+            "■┬ src/module_{}/file_{}.rs\n",
+            section % 97,
+            section
+        ));
+        for value in 0..shape.fan_out {
+            let marker = if value + 1 == shape.fan_out {
+                "└"
+            } else {
+                "├"
+            };
+            let prefix = format!(" {} {}:{}  ", marker, random.next() % 5000 + 1, value + 1);
+            result.push_str(&prefix);
+            let body_length = shape.line_length.saturating_sub(prefix.len());
+            for i in 0..body_length {
+                let byte = b'a' + ((random.next() as usize + i) % 26) as u8;
+                result.push(if i % 7 == 6 { ' ' } else { byte as char });
+            }
+            if value + 1 != shape.fan_out {
+                result.push('\n');
+            }
+        }
+    }
+    result
+}
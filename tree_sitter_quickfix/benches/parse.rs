@@ -0,0 +1,192 @@
+//! Parse benchmarks for the quickfix grammar.
+//!
+//! Run with `cargo bench -p tree-sitter-quickfix`. Besides the timings
+//! reported by criterion (in MB/s), the node count and the peak RSS of the
+//! process are printed for every document shape, and the throughput of every
+//! case in nodes/s.
+
+mod corpus;
+
+use std::time::{Duration, Instant};
+
+use criterion::{criterion_group, criterion_main, BenchmarkId, Criterion, Throughput};
+use tree_sitter::{InputEdit, Parser, Point, Tree};
+
+fn parser() -> Parser {
+    let mut parser = Parser::new();
+    parser
+        .set_language(&tree_sitter_quickfix::language())
+        .expect("Error loading quickfix language");
+    parser
+}
+
+fn node_count(tree: &Tree) -> u64 {
+    let mut cursor = tree.walk();
+    let mut count = 1;
+    loop {
+        if cursor.goto_first_child() || cursor.goto_next_sibling() {
+            count += 1;
+            continue;
+        }
+        loop {
+            if !cursor.goto_parent() {
+                return count;
+            }
+            if cursor.goto_next_sibling() {
+                count += 1;
+                break;
+            }
+        }
+    }
+}
+
+/// Peak resident set size of this process in kB, if available
+fn peak_rss_kb() -> Option<u64> {
+    std::fs::read_to_string("/proc/self/status")
+        .ok()?
+        .lines()
+        .find_map(|line| line.strip_prefix("VmHWM:"))?
+        .trim()
+        .trim_end_matches("kB")
+        .trim()
+        .parse()
+        .ok()
+}
+
+/// Reset the peak resident set size of this process to the current one, so
+/// that the peak reported for a shape is not the one of a larger shape before
+/// it. Only supported on Linux, see `clear_refs` in proc(5).
+fn reset_peak_rss() {
+    let _ = std::fs::write("/proc/self/clear_refs", "5");
+}
+
+/// An edit that replaces one byte in the middle of the document, which
+/// keeps the document well-formed
+fn middle_edit(text: &str) -> (String, InputEdit) {
+    let byte = text.as_bytes()[text.len() / 2..]
+        .iter()
+        .position(|byte| byte.is_ascii_lowercase())
+        .map(|offset| text.len() / 2 + offset)
+        .expect("generated documents contain lowercase letters");
+    let mut new_text = text.to_string();
+    new_text.replace_range(byte..byte + 1, "x");
+    let row = text[..byte].matches('\n').count();
+    let column = byte - text[..byte].rfind('\n').map(|i| i + 1).unwrap_or(0);
+    let position = Point::new(row, column);
+    let end_position = Point::new(row, column + 1);
+    let edit = InputEdit {
+        start_byte: byte,
+        old_end_byte: byte + 1,
+        new_end_byte: byte + 1,
+        start_position: position,
+        old_end_position: end_position,
+        new_end_position: end_position,
+    };
+    (new_text, edit)
+}
+
+/// The time spent in the routine of a case over all the iterations criterion
+/// ran, so that a case runs once but reports both MB/s and nodes/s
+#[derive(Default)]
+struct Timing {
+    elapsed: Duration,
+    iterations: u64,
+}
+
+impl Timing {
+    fn add(&mut self, iterations: u64, elapsed: Duration) -> Duration {
+        self.elapsed += elapsed;
+        self.iterations += iterations;
+        elapsed
+    }
+
+    fn print_nodes_per_second(&self, id: &str, nodes: u64) {
+        if self.iterations == 0 {
+            return;
+        }
+        let per_iteration = self.elapsed.as_secs_f64() / self.iterations as f64;
+        println!(
+            "{id}: {:.3} Mnodes/s",
+            nodes as f64 / per_iteration / 1_000_000.0
+        );
+    }
+}
+
+fn bench_parse(c: &mut Criterion) {
+    for shape in corpus::SHAPES {
+        reset_peak_rss();
+        let text = corpus::generate(*shape);
+        let tree = parser().parse(&text, None).unwrap();
+        assert!(!tree.root_node().has_error());
+        let nodes = node_count(&tree);
+        println!(
+            "{}: {} bytes, {} nodes, peak RSS {} kB",
+            shape.id(),
+            text.len(),
+            nodes,
+            peak_rss_kb().unwrap_or_default()
+        );
+
+        let mut group = c.benchmark_group("quickfix");
+        group
+            .throughput(Throughput::Bytes(text.len() as u64))
+            .sample_size(10);
+
+        let id = BenchmarkId::new("full", shape.id());
+        let name = format!("quickfix/full/{}", shape.id());
+        let mut timing = Timing::default();
+        group.bench_with_input(id, &text, |b, text| {
+            let mut parser = parser();
+            b.iter_custom(|iterations| {
+                let start = Instant::now();
+                for _ in 0..iterations {
+                    criterion::black_box(parser.parse(text, None).unwrap());
+                }
+                timing.add(iterations, start.elapsed())
+            })
+        });
+        timing.print_nodes_per_second(&name, nodes);
+
+        let id = BenchmarkId::new("incremental_edit", shape.id());
+        let name = format!("quickfix/incremental_edit/{}", shape.id());
+        let mut timing = Timing::default();
+        group.bench_with_input(id, &text, |b, text| {
+            let mut parser = parser();
+            let (new_text, edit) = middle_edit(text);
+            b.iter_custom(|iterations| {
+                let mut elapsed = Duration::ZERO;
+                for _ in 0..iterations {
+                    let mut old_tree = tree.clone();
+                    old_tree.edit(&edit);
+                    let start = Instant::now();
+                    let new_tree = parser.parse(&new_text, Some(&old_tree)).unwrap();
+                    elapsed += start.elapsed();
+                    // Both trees are dropped outside of the measurement
+                    drop((old_tree, new_tree));
+                }
+                timing.add(iterations, elapsed)
+            })
+        });
+        timing.print_nodes_per_second(&name, nodes);
+
+        let id = BenchmarkId::new("reparse", shape.id());
+        let name = format!("quickfix/reparse/{}", shape.id());
+        let mut timing = Timing::default();
+        group.bench_with_input(id, &text, |b, text| {
+            let mut parser = parser();
+            b.iter_custom(|iterations| {
+                let start = Instant::now();
+                for _ in 0..iterations {
+                    criterion::black_box(parser.parse(text, Some(&tree)).unwrap());
+                }
+                timing.add(iterations, start.elapsed())
+            })
+        });
+        timing.print_nodes_per_second(&name, nodes);
+
+        group.finish();
+    }
+}
+
+criterion_group!(benches, bench_parse);
+criterion_main!(benches);
@@ -1,18 +1,53 @@
 {
+  "variables": {
+    # Opt-in optimizations, e.g. `GYP_DEFINES="quickfix_lto=true" npm install`:
+    # `quickfix_lto` links the parser and the binding with LTO,
+    # `quickfix_pgo` is "generate" or "use", with profiles in `quickfix_pgo_dir`
+    "quickfix_lto%": "false",
+    "quickfix_pgo%": "",
+    "quickfix_pgo_dir%": "<(module_root_dir)/build/pgo",
+    # The tree-sitter runtime, needed by `parseBuffer` and friends, is built
+    # from the sources node-tree-sitter ships, like node-tree-sitter itself
+    # does, so that no system library is needed and both agree on the version
+    "tree_sitter_lib%": "<!(node -p \"require('path').join(require('path').dirname(require.resolve('tree-sitter/package.json')), 'vendor', 'tree-sitter', 'lib')\")",
+  },
   "targets": [
     {
       "target_name": "tree_sitter_quickfix_binding",
       "include_dirs": [
-        "<!(node -e \"require('nan')\")",
+        "<!(node -p \"require('node-addon-api').include_dir\")",
+        "<(tree_sitter_lib)/include",
+        "<(tree_sitter_lib)/src",
         "src"
       ],
       "sources": [
         "bindings/node/binding.cc",
         "src/parser.c",
-        # If your language uses an external scanner, add it here.
+        "<(tree_sitter_lib)/src/lib.c",
+      ],
+      "defines": [
+        "NAPI_VERSION=8",
+        "NAPI_DISABLE_CPP_EXCEPTIONS",
       ],
       "cflags_c": [
-        "-std=c99",
+        "-std=c11",
+      ],
+      "conditions": [
+        ["quickfix_lto=='true'", {
+          "cflags": ["-O3", "-flto"],
+          "ldflags": ["-flto"],
+          "xcode_settings": {
+            "GCC_OPTIMIZATION_LEVEL": "3",
+            "LLVM_LTO": "YES",
+          },
+        }],
+        ["quickfix_pgo=='generate'", {
+          "cflags": ["-fprofile-generate=<(quickfix_pgo_dir)", "-fprofile-update=prefer-atomic"],
+          "ldflags": ["-fprofile-generate=<(quickfix_pgo_dir)"],
+        }],
+        ["quickfix_pgo=='use'", {
+          "cflags": ["-fprofile-use=<(quickfix_pgo_dir)", "-fprofile-partial-training", "-Wno-missing-profile"],
+        }],
       ]
     }
   ]
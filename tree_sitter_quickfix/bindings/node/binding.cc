@@ -1,28 +1,522 @@
-#include "tree_sitter/parser.h"
-#include <node.h>
-#include "nan.h"
+#include <napi.h>
+#include <tree_sitter/api.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
 
-using namespace v8;
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
-extern "C" TSLanguage * tree_sitter_quickfix();
+extern "C" const TSLanguage *tree_sitter_quickfix();
 
 namespace {
 
-NAN_METHOD(New) {}
+// "tree-sitter", "language" hashed with BLAKE2, which is how node-tree-sitter
+// recognizes a language object
+const napi_type_tag LANGUAGE_TYPE_TAG = {
+  0x8AF2E5212AD58ABF, 0xD5006CAD83ABBA16
+};
 
-void Init(Local<Object> exports, Local<Object> module) {
-  Local<FunctionTemplate> tpl = Nan::New<FunctionTemplate>(New);
-  tpl->SetClassName(Nan::New("Language").ToLocalChecked());
-  tpl->InstanceTemplate()->SetInternalFieldCount(1);
+// The payload of a `TSInput` reading directly from the memory of a JS
+// `Buffer`/`ArrayBuffer`, so that the document is never copied.
+struct BufferInput {
+  const char *data;
+  uint32_t length;
+};
 
-  Local<Function> constructor = Nan::GetFunction(tpl).ToLocalChecked();
-  Local<Object> instance = constructor->NewInstance(Nan::GetCurrentContext()).ToLocalChecked();
-  Nan::SetInternalFieldPointer(instance, 0, tree_sitter_quickfix());
+const char *ReadBuffer(void *payload, uint32_t byte_index, TSPoint, uint32_t *bytes_read) {
+  BufferInput *input = static_cast<BufferInput *>(payload);
+  if (byte_index >= input->length) {
+    *bytes_read = 0;
+    return "";
+  }
+  *bytes_read = input->length - byte_index;
+  return input->data + byte_index;
+}
+
+// Get the bytes backing a `Buffer`, `ArrayBuffer` or any `TypedArray` without
+// copying them. Otherwise throws a TypeError, or a RangeError for buffers of
+// 4 GiB or more, which tree-sitter's 32-bit byte offsets cannot address, and
+// returns false.
+bool GetBufferInput(Napi::Value value, BufferInput *input) {
+  const char *data;
+  size_t length;
+  if (value.IsArrayBuffer()) {
+    Napi::ArrayBuffer buffer = value.As<Napi::ArrayBuffer>();
+    data = static_cast<const char *>(buffer.Data());
+    length = buffer.ByteLength();
+  } else if (value.IsTypedArray()) {
+    Napi::TypedArray array = value.As<Napi::TypedArray>();
+    data = static_cast<const char *>(array.ArrayBuffer().Data()) + array.ByteOffset();
+    length = array.ByteLength();
+  } else {
+    Napi::TypeError::New(value.Env(), "Expected a Buffer, TypedArray or ArrayBuffer")
+        .ThrowAsJavaScriptException();
+    return false;
+  }
+  if (length > UINT32_MAX) {
+    Napi::RangeError::New(value.Env(), "Cannot parse documents of 4 GiB or more")
+        .ThrowAsJavaScriptException();
+    return false;
+  }
+  input->data = data;
+  input->length = static_cast<uint32_t>(length);
+  return true;
+}
+
+// A read-only mapping of a whole file, so that huge quickfix dumps can be
+// parsed without reading them into memory first.
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string &path) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return;
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(file, &size) && size.QuadPart <= UINT32_MAX) {
+      length_ = static_cast<uint32_t>(size.QuadPart);
+      HANDLE mapping =
+          length_ ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+      if (mapping) {
+        data_ = static_cast<const char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        CloseHandle(mapping);
+      }
+      ok_ = length_ == 0 || data_;
+    }
+    CloseHandle(file);
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size <= UINT32_MAX) {
+      length_ = static_cast<uint32_t>(info.st_size);
+      void *data = length_ ? mmap(nullptr, length_, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+      if (data != MAP_FAILED) {
+        data_ = static_cast<const char *>(data);
+        // The parser reads the file from start to end exactly once
+        if (data_) madvise(data, length_, MADV_SEQUENTIAL);
+        ok_ = true;
+      }
+    }
+    close(fd);
+#endif
+  }
+
+  ~MappedFile() {
+    if (!data_) return;
+#ifdef _WIN32
+    UnmapViewOfFile(data_);
+#else
+    munmap(const_cast<char *>(data_), length_);
+#endif
+  }
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  bool ok() const { return ok_; }
+  BufferInput input() const { return {data_ ? data_ : "", length_}; }
+
+ private:
+  bool ok_ = false;
+  const char *data_ = nullptr;
+  uint32_t length_ = 0;
+};
+
+// What is measured for every parse. Counting lexer calls needs a logger,
+// which formats a message for every lexer and parser action, so it is only
+// done in detailed mode, see `setDetailedStats`.
+struct ParseStats {
+  uint32_t bytes = 0;
+  uint32_t node_count = 0;
+  double parse_time_ms = 0;
+  bool detailed = false;
+  uint64_t lexer_calls = 0;
+};
+
+// Totals over all parses of this process, see `getCounters`
+std::atomic<uint64_t> total_parses(0);
+std::atomic<uint64_t> total_bytes(0);
+std::atomic<uint64_t> total_nodes(0);
+std::atomic<uint64_t> total_parse_time_us(0);
+std::atomic<uint64_t> total_lexer_calls(0);
+
+void CountLexerCalls(void *payload, TSLogType type, const char *message) {
+  // See `ts_parser__lex` in the tree-sitter runtime
+  if (type == TSLogTypeParse && strncmp(message, "lexed_lookahead", 15) == 0) {
+    static_cast<ParseStats *>(payload)->lexer_calls++;
+  }
+}
+
+TSTree *InstrumentedParse(TSParser *parser, BufferInput *payload, bool detailed,
+                          ParseStats *stats) {
+  stats->detailed = detailed;
+  if (detailed) ts_parser_set_logger(parser, {stats, CountLexerCalls});
+  auto start = std::chrono::steady_clock::now();
+  TSInput input = {payload, ReadBuffer, TSInputEncodingUTF8};
+  TSTree *tree = ts_parser_parse(parser, nullptr, input);
+  std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+  if (detailed) ts_parser_set_logger(parser, {nullptr, nullptr});
+
+  stats->bytes = payload->length;
+  stats->node_count = tree ? ts_node_descendant_count(ts_tree_root_node(tree)) : 0;
+  stats->parse_time_ms = elapsed.count() / 1000;
+  total_parses++;
+  total_bytes += stats->bytes;
+  total_nodes += stats->node_count;
+  total_parse_time_us += static_cast<uint64_t>(elapsed.count());
+  total_lexer_calls += stats->lexer_calls;
+  return tree;
+}
 
-  Nan::Set(instance, Nan::New("name").ToLocalChecked(), Nan::New("quickfix").ToLocalChecked());
-  Nan::Set(module, Nan::New("exports").ToLocalChecked(), instance);
+// A parsed tree, owned by the JS object that wraps it. Only what the fast
+// paths are for, validating and measuring documents, is exposed; trees to walk
+// or query come from a node-tree-sitter `Parser` with the exported language.
+class Tree : public Napi::ObjectWrap<Tree> {
+ public:
+  static Napi::Function Init(Napi::Env env) {
+    return DefineClass(env, "Tree", {
+      InstanceMethod("toString", &Tree::ToString),
+      InstanceMethod("hasError", &Tree::HasError),
+      InstanceMethod("stats", &Tree::Stats),
+    });
+  }
+
+  // Wraps `tree`, or returns null if the parse did not produce one
+  static Napi::Value NewInstance(Napi::Env env, TSTree *tree, const ParseStats &stats);
+
+  explicit Tree(const Napi::CallbackInfo &info) : Napi::ObjectWrap<Tree>(info) {}
+
+  ~Tree() {
+    if (tree_) ts_tree_delete(tree_);
+  }
+
+ private:
+  Napi::Value ToString(const Napi::CallbackInfo &info) {
+    if (!tree_) return info.Env().Null();
+    char *string = ts_node_string(ts_tree_root_node(tree_));
+    Napi::String result = Napi::String::New(info.Env(), string);
+    free(string);
+    return result;
+  }
+
+  Napi::Value HasError(const Napi::CallbackInfo &info) {
+    if (!tree_) return info.Env().Null();
+    return Napi::Boolean::New(info.Env(), ts_node_has_error(ts_tree_root_node(tree_)));
+  }
+
+  // `tree.stats()`: how the tree was parsed. `lexerCalls` is null unless
+  // detailed stats were enabled.
+  Napi::Value Stats(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+    Napi::Object result = Napi::Object::New(env);
+    result["bytes"] = Napi::Number::New(env, stats_.bytes);
+    result["nodeCount"] = Napi::Number::New(env, stats_.node_count);
+    result["parseTimeMs"] = Napi::Number::New(env, stats_.parse_time_ms);
+    result["lexerCalls"] = stats_.detailed
+                               ? Napi::Value(Napi::Number::New(env, stats_.lexer_calls))
+                               : env.Null();
+    return result;
+  }
+
+  TSTree *tree_ = nullptr;
+  ParseStats stats_;
+};
+
+// Everything that would otherwise be a global lives here, one instance per
+// environment (main thread or worker), so that the addon is context-aware.
+struct AddonData {
+  Napi::FunctionReference tree_constructor;
+  bool detailed_stats = false;
+};
+
+Napi::Value Tree::NewInstance(Napi::Env env, TSTree *tree, const ParseStats &stats) {
+  if (!tree) return env.Null();
+  Napi::Object instance = env.GetInstanceData<AddonData>()->tree_constructor.New({});
+  Tree *wrapper = Tree::Unwrap(instance);
+  wrapper->tree_ = tree;
+  wrapper->stats_ = stats;
+  return instance;
 }
 
-NODE_MODULE(tree_sitter_quickfix_binding, Init)
+// `parseBuffer(buffer)`: parse a UTF-8 encoded quickfix document in place.
+Napi::Value ParseBuffer(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+  BufferInput payload;
+  // `info[0]` is undefined when there are no arguments
+  if (!GetBufferInput(info[0], &payload)) return env.Undefined();
+
+  bool detailed = env.GetInstanceData<AddonData>()->detailed_stats;
+  TSParser *parser = ts_parser_new();
+  ts_parser_set_language(parser, tree_sitter_quickfix());
+  ParseStats stats;
+  TSTree *tree = InstrumentedParse(parser, &payload, detailed, &stats);
+  ts_parser_delete(parser);
+
+  return Tree::NewInstance(env, tree, stats);
+}
+
+// Parses a buffer on the libuv threadpool for `parseAsync`. The buffer is
+// referenced until the parse is done, so that it cannot be collected while a
+// worker thread reads from it.
+class ParseWorker : public Napi::AsyncWorker {
+ public:
+  ParseWorker(Napi::Env env, Napi::Value buffer, BufferInput payload, bool detailed,
+              std::shared_ptr<size_t> cancelled)
+      : Napi::AsyncWorker(env, "parseAsync"),
+        deferred_(Napi::Promise::Deferred::New(env)),
+        buffer_(Napi::Persistent(buffer)),
+        payload_(payload),
+        detailed_(detailed),
+        cancelled_(std::move(cancelled)) {}
+
+  Napi::Promise Promise() const { return deferred_.Promise(); }
+
+ protected:
+  void Execute() override {
+    TSParser *parser = ts_parser_new();
+    ts_parser_set_language(parser, tree_sitter_quickfix());
+    // Only ever read by the runtime, which polls it between parse steps with an
+    // atomic load
+    ts_parser_set_cancellation_flag(parser, cancelled_.get());
+    tree_ = InstrumentedParse(parser, &payload_, detailed_, &stats_);
+    ts_parser_delete(parser);
+    if (!tree_) SetError("Parse cancelled");
+  }
+
+  void OnOK() override { deferred_.Resolve(Tree::NewInstance(Env(), tree_, stats_)); }
+
+  void OnError(const Napi::Error &error) override {
+    Napi::Object value = error.Value();
+    value["code"] = Napi::String::New(Env(), "ABORT_ERR");
+    deferred_.Reject(value);
+  }
+
+ private:
+  Napi::Promise::Deferred deferred_;
+  Napi::Reference<Napi::Value> buffer_;
+  BufferInput payload_;
+  bool detailed_;
+  std::shared_ptr<size_t> cancelled_;
+  TSTree *tree_ = nullptr;
+  ParseStats stats_;
+};
+
+// The parser reads its cancellation flag with an atomic load on the worker
+// thread (see `atomic_load` in the runtime's `lib/src/atomic.h`), so the flag
+// has to be written atomically too.
+void SetCancellationFlag(size_t *flag) {
+#ifdef _WIN32
+  InterlockedExchangePointer(reinterpret_cast<PVOID volatile *>(flag), reinterpret_cast<PVOID>(1));
+#else
+  __atomic_store_n(flag, 1, __ATOMIC_SEQ_CST);
+#endif
+}
+
+// `parseAsync(buffer)`: like `parseBuffer`, but parse on the libuv threadpool
+// and return a promise of the tree, so that the event loop keeps running
+// meanwhile. `promise.cancel()` stops the parse, and rejects the promise with
+// an error whose `code` is "ABORT_ERR" unless it has already settled. The
+// buffer must not be modified until the promise is settled.
+Napi::Value ParseAsync(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+  BufferInput payload;
+  // `info[0]` is undefined when there are no arguments
+  if (!GetBufferInput(info[0], &payload)) return env.Undefined();
+
+  // Shared with `cancel`, which may be called after the worker is gone. A plain
+  // `size_t`, which is the type `ts_parser_set_cancellation_flag` takes.
+  auto cancelled = std::make_shared<size_t>(0);
+  bool detailed = env.GetInstanceData<AddonData>()->detailed_stats;
+  ParseWorker *worker = new ParseWorker(env, info[0], payload, detailed, cancelled);
+  Napi::Promise promise = worker->Promise();
+  promise["cancel"] = Napi::Function::New(
+      env,
+      [cancelled](const Napi::CallbackInfo &info) -> Napi::Value {
+        SetCancellationFlag(cancelled.get());
+        return info.Env().Undefined();
+      },
+      "cancel");
+  worker->Queue();
+  return promise;
+}
+
+// `parseFile(path)`: memory-map the file at `path` and parse it, reading from
+// the mapping directly. The tree does not reference the text, so the file is
+// unmapped again before returning.
+Napi::Value ParseFile(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+  if (info.Length() < 1 || !info[0].IsString()) {
+    Napi::TypeError::New(env, "Expected a path").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  std::string path = info[0].As<Napi::String>().Utf8Value();
+  MappedFile file(path);
+  if (!file.ok()) {
+    Napi::Error::New(env, "Could not map " + path).ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  BufferInput payload = file.input();
+  bool detailed = env.GetInstanceData<AddonData>()->detailed_stats;
+  TSParser *parser = ts_parser_new();
+  ts_parser_set_language(parser, tree_sitter_quickfix());
+  ParseStats stats;
+  TSTree *tree = InstrumentedParse(parser, &payload, detailed, &stats);
+  ts_parser_delete(parser);
+
+  return Tree::NewInstance(env, tree, stats);
+}
+
+// The documents of one `parseBuffers` call, shared by its workers. The workers
+// take the documents one by one through `next_input`, so that every tree and
+// stats entry is written by exactly one of them; everything else is only used
+// on the JS thread.
+struct ParseBatch {
+  ParseBatch(Napi::Env env, Napi::Value buffers, std::vector<BufferInput> inputs, bool detailed)
+      : deferred(Napi::Promise::Deferred::New(env)),
+        buffers(Napi::Persistent(buffers)),
+        inputs(std::move(inputs)),
+        detailed(detailed),
+        trees(this->inputs.size(), nullptr),
+        stats(this->inputs.size()) {}
+
+  Napi::Promise::Deferred deferred;
+  // Keeps the buffers alive until the batch is done
+  Napi::Reference<Napi::Value> buffers;
+  std::vector<BufferInput> inputs;
+  bool detailed;
+  std::vector<TSTree *> trees;
+  std::vector<ParseStats> stats;
+  std::atomic<size_t> next_input{0};
+  size_t pending_workers = 0;
+};
+
+// One of the workers of a `parseBuffers` call, on the libuv threadpool, with a
+// `TSParser` of its own.
+class ParseBatchWorker : public Napi::AsyncWorker {
+ public:
+  ParseBatchWorker(Napi::Env env, std::shared_ptr<ParseBatch> batch)
+      : Napi::AsyncWorker(env, "parseBuffers"), batch_(std::move(batch)) {}
+
+ protected:
+  void Execute() override {
+    ParseBatch &batch = *batch_;
+    TSParser *parser = ts_parser_new();
+    ts_parser_set_language(parser, tree_sitter_quickfix());
+    for (size_t i = batch.next_input++; i < batch.inputs.size(); i = batch.next_input++) {
+      batch.trees[i] = InstrumentedParse(parser, &batch.inputs[i], batch.detailed, &batch.stats[i]);
+    }
+    ts_parser_delete(parser);
+  }
+
+  // The last worker to finish resolves the promise
+  void OnOK() override {
+    ParseBatch &batch = *batch_;
+    if (--batch.pending_workers > 0) return;
+    Napi::Env env = Env();
+    Napi::Array result = Napi::Array::New(env, batch.trees.size());
+    for (uint32_t i = 0; i < batch.trees.size(); i++) {
+      result[i] = Tree::NewInstance(env, batch.trees[i], batch.stats[i]);
+    }
+    batch.deferred.Resolve(result);
+  }
+
+ private:
+  std::shared_ptr<ParseBatch> batch_;
+};
+
+// `parseBuffers(buffers)`: parse many documents at once on the libuv
+// threadpool, one `TSParser` per worker, and return a promise of the trees, in
+// the same order as `buffers`. The buffers must not be modified until the
+// promise is settled.
+Napi::Value ParseBuffers(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+  if (info.Length() < 1 || !info[0].IsArray()) {
+    Napi::TypeError::New(env, "Expected an array of Buffers").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  Napi::Array buffers = info[0].As<Napi::Array>();
+  std::vector<BufferInput> inputs(buffers.Length());
+  for (uint32_t i = 0; i < inputs.size(); i++) {
+    if (!GetBufferInput(buffers.Get(i), &inputs[i])) return env.Undefined();
+  }
+
+  bool detailed = env.GetInstanceData<AddonData>()->detailed_stats;
+  auto batch = std::make_shared<ParseBatch>(env, buffers, std::move(inputs), detailed);
+  Napi::Promise promise = batch->deferred.Promise();
+  if (batch->inputs.empty()) {
+    batch->deferred.Resolve(Napi::Array::New(env, 0));
+    return promise;
+  }
+  // Workers queued behind a busy threadpool find nothing left to parse, and
+  // finish right away
+  size_t worker_count =
+      std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), batch->inputs.size());
+  batch->pending_workers = worker_count;
+  for (size_t i = 0; i < worker_count; i++) (new ParseBatchWorker(env, batch))->Queue();
+  return promise;
+}
+
+// `setDetailedStats(enabled)`: also count lexer calls in `tree.stats()` and
+// `getCounters()`, which slows parsing down.
+Napi::Value SetDetailedStats(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+  env.GetInstanceData<AddonData>()->detailed_stats =
+      info.Length() > 0 && info[0].ToBoolean().Value();
+  return env.Undefined();
+}
+
+// `getCounters()`: totals over all parses of this process, for exporting as
+// monotonic counters.
+Napi::Value GetCounters(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+  Napi::Object result = Napi::Object::New(env);
+  result["parses"] = Napi::Number::New(env, total_parses.load());
+  result["bytes"] = Napi::Number::New(env, total_bytes.load());
+  result["nodes"] = Napi::Number::New(env, total_nodes.load());
+  result["parseTimeUs"] = Napi::Number::New(env, total_parse_time_us.load());
+  result["lexerCalls"] = Napi::Number::New(env, total_lexer_calls.load());
+  return result;
+}
+
+Napi::Object Init(Napi::Env env, Napi::Object exports) {
+  AddonData *data = new AddonData();
+  data->tree_constructor = Napi::Persistent(Tree::Init(env));
+  env.SetInstanceData(data);
+
+  // What node-tree-sitter expects of a language module, so that
+  // `parser.setLanguage(require("tree-sitter-quickfix"))` keeps working
+  exports["name"] = Napi::String::New(env, "quickfix");
+  auto language = Napi::External<TSLanguage>::New(
+      env, const_cast<TSLanguage *>(tree_sitter_quickfix()));
+  language.TypeTag(&LANGUAGE_TYPE_TAG);
+  exports["language"] = language;
+  // The fast paths, next to the language. They parse with the shared tree-sitter
+  // library rather than the runtime of node-tree-sitter, so their trees are the
+  // `Tree`s above, not node-tree-sitter trees.
+  exports["parseBuffer"] = Napi::Function::New(env, ParseBuffer, "parseBuffer");
+  exports["parseAsync"] = Napi::Function::New(env, ParseAsync, "parseAsync");
+  exports["parseFile"] = Napi::Function::New(env, ParseFile, "parseFile");
+  exports["parseBuffers"] = Napi::Function::New(env, ParseBuffers, "parseBuffers");
+  exports["setDetailedStats"] = Napi::Function::New(env, SetDetailedStats, "setDetailedStats");
+  exports["getCounters"] = Napi::Function::New(env, GetCounters, "getCounters");
+  return exports;
+}
 
 }  // namespace
+
+NODE_API_MODULE(tree_sitter_quickfix_binding, Init)
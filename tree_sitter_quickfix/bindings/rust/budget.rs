@@ -0,0 +1,176 @@
+//! Parsing within a time budget.
+//!
+//! A [`BudgetedParser`] gives up once its budget is spent, and continues where
+//! it stopped on the next call, so that a huge quickfix list can be parsed a
+//! slice per frame without blocking input. A parse can also be abandoned,
+//! either directly or through a [`CancelHandle`] from another thread.
+
+use std::{
+    sync::{
+        atomic::{AtomicUsize, Ordering},
+        Arc,
+    },
+    time::Duration,
+};
+
+use tree_sitter::{Language, Parser, Point, Tree};
+
+#[derive(Debug)]
+pub enum ParseOutcome {
+    Done(Tree),
+    /// The budget was spent. Parsing again with the same input continues the
+    /// parse.
+    Pending,
+    /// The parse was cancelled and has been abandoned
+    Cancelled,
+}
+
+/// Cancels the parse of a [`BudgetedParser`], e.g. from another thread. If no
+/// parse is running, the next one is cancelled.
+#[derive(Debug, Clone)]
+pub struct CancelHandle(Arc<AtomicUsize>);
+
+impl CancelHandle {
+    pub fn cancel(&self) {
+        self.0.store(1, Ordering::SeqCst)
+    }
+}
+
+pub struct BudgetedParser {
+    // Declared before `cancelled`, so that the parser, which holds a pointer
+    // to the flag, is dropped first
+    parser: Parser,
+    cancelled: Arc<AtomicUsize>,
+    budget: Option<Duration>,
+    pending: bool,
+}
+
+impl BudgetedParser {
+    /// A parser of `language` that spends at most `budget` per parse call, or
+    /// parses to the end if `budget` is `None`.
+    pub fn new(language: &Language, budget: Option<Duration>) -> Self {
+        let mut parser = Parser::new();
+        parser
+            .set_language(language)
+            .expect("Error loading quickfix language");
+        let cancelled = Arc::new(AtomicUsize::new(0));
+        // SAFETY: the flag is owned by `self` and outlives the parser
+        unsafe { parser.set_cancellation_flag(Some(&*cancelled)) };
+        Self {
+            parser,
+            cancelled,
+            budget,
+            pending: false,
+        }
+    }
+
+    pub fn set_budget(&mut self, budget: Option<Duration>) {
+        self.budget = budget
+    }
+
+    pub fn cancel_handle(&self) -> CancelHandle {
+        CancelHandle(self.cancelled.clone())
+    }
+
+    /// Whether a parse ran out of budget and can be continued
+    pub fn is_pending(&self) -> bool {
+        self.pending
+    }
+
+    /// Drop the pending parse, if any, so that the next call starts over
+    pub fn abandon(&mut self) {
+        self.parser.reset();
+        self.pending = false;
+    }
+
+    /// Restrict the next parse to `ranges`, see
+    /// [`Parser::set_included_ranges`]. Abandons the pending parse, which was
+    /// of other ranges.
+    pub fn set_included_ranges(&mut self, ranges: &[tree_sitter::Range]) {
+        self.abandon();
+        self.parser
+            .set_included_ranges(ranges)
+            .expect("Included ranges must be ordered")
+    }
+
+    /// Parse for at most the budget, see [`Parser::parse_with`]. A pending
+    /// parse is continued, in which case `input` must read the same document
+    /// as before, and `old_tree` is ignored.
+    pub fn parse_with<T: AsRef<[u8]>, F: FnMut(usize, Point) -> T>(
+        &mut self,
+        input: &mut F,
+        old_tree: Option<&Tree>,
+    ) -> ParseOutcome {
+        // A timeout of 0 means no timeout
+        let timeout = self
+            .budget
+            .map_or(0, |budget| (budget.as_micros() as u64).max(1));
+        self.parser.set_timeout_micros(timeout);
+        match self.parser.parse_with(input, old_tree) {
+            Some(tree) => {
+                self.pending = false;
+                ParseOutcome::Done(tree)
+            }
+            None if self.cancelled.swap(0, Ordering::SeqCst) == 0 && self.budget.is_some() => {
+                self.pending = true;
+                ParseOutcome::Pending
+            }
+            None => {
+                self.abandon();
+                ParseOutcome::Cancelled
+            }
+        }
+    }
+}
+
+#[cfg(test)]
+mod test_budget {
+    use std::time::Duration;
+
+    use super::{BudgetedParser, ParseOutcome};
+    use crate::document;
+
+    #[test]
+    fn should_resume_parse_after_budget_is_spent() {
+        let text = document(20_000);
+        let bytes = text.as_bytes();
+        let mut input = |byte: usize, _: tree_sitter::Point| bytes.get(byte..).unwrap_or_default();
+        let language = crate::language();
+        let mut parser = BudgetedParser::new(&language, Some(Duration::from_micros(1)));
+
+        let mut pending_calls = 0;
+        let tree = loop {
+            match parser.parse_with(&mut input, None) {
+                ParseOutcome::Done(tree) => break tree,
+                ParseOutcome::Pending => pending_calls += 1,
+                ParseOutcome::Cancelled => panic!("not cancelled"),
+            }
+        };
+        assert!(pending_calls > 0);
+        assert!(!parser.is_pending());
+
+        let mut full_parser = tree_sitter::Parser::new();
+        full_parser.set_language(&language).unwrap();
+        let full_tree = full_parser.parse(&text, None).unwrap();
+        assert_eq!(tree.root_node().to_sexp(), full_tree.root_node().to_sexp());
+    }
+
+    #[test]
+    fn cancelled_parse_should_start_over() {
+        let text = document(100);
+        let bytes = text.as_bytes();
+        let mut input = |byte: usize, _: tree_sitter::Point| bytes.get(byte..).unwrap_or_default();
+        let mut parser = BudgetedParser::new(&crate::language(), Some(Duration::from_secs(10)));
+
+        parser.cancel_handle().cancel();
+        assert!(matches!(
+            parser.parse_with(&mut input, None),
+            ParseOutcome::Cancelled
+        ));
+        assert!(!parser.is_pending());
+        let ParseOutcome::Done(tree) = parser.parse_with(&mut input, None) else {
+            panic!("expected a tree")
+        };
+        assert_eq!(tree.root_node().named_child_count(), 100);
+    }
+}
@@ -19,6 +19,19 @@ fn main() {
     println!("cargo:rerun-if-changed={}", scanner_path.to_str().unwrap());
     */
 
+    // `--features optimize` compiles the parser with -O3, whatever the
+    // opt-level of the profile. `QUICKFIX_LTO=1` additionally emits LLVM
+    // bitcode (with clang), for link-time optimization across the parser and
+    // its Rust callers; see `bench-lto` in the justfile for the linker flags
+    // this needs.
+    if std::env::var_os("CARGO_FEATURE_OPTIMIZE").is_some() {
+        c_config.opt_level(3);
+        if std::env::var_os("QUICKFIX_LTO").is_some() {
+            c_config.flag("-flto=thin");
+        }
+    }
+    println!("cargo:rerun-if-env-changed=QUICKFIX_LTO");
+
     c_config.compile("parser");
     println!("cargo:rerun-if-changed={}", parser_path.to_str().unwrap());
 
@@ -0,0 +1,150 @@
+//! A cache of parsed quickfix lists.
+//!
+//! The same few quickfix lists (diagnostics, references, grep results) are
+//! shown again and again, and each time they are rendered to the exact same
+//! text. [`TreeCache`] keeps the trees of the most recently shown lists,
+//! keyed by a hash of their text, so that showing a list again reuses its
+//! tree instead of parsing it again.
+
+use std::collections::VecDeque;
+
+use xxhash_rust::xxh3::xxh3_64;
+
+use crate::ViewportTree;
+
+/// Identifies the text of a quickfix list
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
+pub struct ContentKey {
+    hash: u64,
+    len: usize,
+}
+
+impl ContentKey {
+    pub fn new(text: &str) -> Self {
+        Self {
+            hash: xxh3_64(text.as_bytes()),
+            len: text.len(),
+        }
+    }
+}
+
+/// A least recently used cache of [`ViewportTree`]s.
+pub struct TreeCache {
+    capacity: usize,
+    /// The most recently used entry is at the back
+    entries: VecDeque<(ContentKey, ViewportTree)>,
+    hits: u64,
+    misses: u64,
+}
+
+impl TreeCache {
+    pub fn new(capacity: usize) -> Self {
+        Self {
+            capacity,
+            entries: VecDeque::with_capacity(capacity + 1),
+            hits: 0,
+            misses: 0,
+        }
+    }
+
+    /// Get a copy of the tree of `key`. Copying only increments the reference
+    /// count of the tree (`ts_tree_copy`), and the cached tree stays valid.
+    pub fn get(&mut self, key: ContentKey) -> Option<ViewportTree> {
+        let Some(index) = self.entries.iter().position(|(entry, _)| *entry == key) else {
+            self.misses += 1;
+            return None;
+        };
+        self.hits += 1;
+        let entry = self.entries.remove(index)?;
+        let tree = entry.1.clone();
+        self.entries.push_back(entry);
+        Some(tree)
+    }
+
+    /// Cache `tree` as the tree of `key`, replacing the previous tree of
+    /// `key`, and evicting the least recently used tree if the cache is full.
+    /// A parse of `tree` that ran out of budget is abandoned, as its parser
+    /// moves on to other content.
+    pub fn insert(&mut self, key: ContentKey, mut tree: ViewportTree) {
+        tree.abandon();
+        self.entries.retain(|(entry, _)| *entry != key);
+        self.entries.push_back((key, tree));
+        while self.entries.len() > self.capacity {
+            self.entries.pop_front();
+        }
+    }
+
+    pub fn len(&self) -> usize {
+        self.entries.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.entries.is_empty()
+    }
+
+    pub fn hits(&self) -> u64 {
+        self.hits
+    }
+
+    pub fn misses(&self) -> u64 {
+        self.misses
+    }
+}
+
+#[cfg(test)]
+mod test_cache {
+    use tree_sitter::Point;
+
+    use super::{ContentKey, TreeCache};
+    use crate::{document, BudgetedParser, ViewportProgress, ViewportTree};
+
+    #[test]
+    fn should_evict_least_recently_used_tree() {
+        let texts = ["■┬ a.rs\n └ 1: a", "■┬ b.rs\n └ 1: b", "■┬ c.rs\n └ 1: c"];
+        let keys = texts.map(ContentKey::new);
+        let mut cache = TreeCache::new(2);
+        assert!(cache.get(keys[0]).is_none());
+        for (key, text) in keys.iter().zip(texts).take(2) {
+            cache.insert(*key, ViewportTree::new(text, 0));
+        }
+        assert!(cache.get(keys[0]).is_some());
+
+        // `b.rs` is now the least recently used
+        cache.insert(keys[2], ViewportTree::new(texts[2], 0));
+        assert_eq!(cache.len(), 2);
+        assert!(cache.get(keys[1]).is_none());
+        assert!(cache.get(keys[0]).is_some());
+        assert!(cache.get(keys[2]).is_some());
+        assert_eq!((cache.hits(), cache.misses()), (3, 2));
+    }
+
+    #[test]
+    fn cached_tree_should_not_be_pending() {
+        let text = document(20_000);
+        let bytes = text.as_bytes();
+        let mut input = |byte: usize, _: Point| bytes.get(byte..).unwrap_or_default();
+        let mut parser = BudgetedParser::new(
+            &crate::language(),
+            Some(std::time::Duration::from_micros(1)),
+        );
+        let mut viewport = ViewportTree::new(&text, 0);
+        assert_eq!(
+            viewport.ensure_visible_within(0..80_000, &mut parser, &mut input),
+            ViewportProgress::Pending
+        );
+
+        let key = ContentKey::new(&text);
+        let mut cache = TreeCache::new(1);
+        cache.insert(key, viewport);
+        let mut viewport = cache.get(key).unwrap();
+        assert!(!viewport.is_pending());
+        // The parser starts over with the visible sections only, instead of
+        // continuing with all of them
+        parser.set_budget(None);
+        assert_eq!(
+            viewport.ensure_visible_within(0..3, &mut parser, &mut input),
+            ViewportProgress::Changed
+        );
+        assert_eq!(viewport.tree().unwrap().root_node().named_child_count(), 1);
+    }
+}
@@ -0,0 +1,124 @@
+//! The sections that differ between two trees of a quickfix document.
+//!
+//! Decorations and highlights of a quickfix list are attached to whole
+//! sections, so after the list is updated only the sections touched by the
+//! update need to be decorated again. [`changed_sections`] widens the ranges
+//! reported by `ts_tree_get_changed_ranges` to the sections they overlap.
+
+use std::ops::Range;
+
+use tree_sitter::{Node, Tree};
+
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct ChangedSections {
+    /// From the start of the first changed section to the end of the last
+    /// one, in the new tree
+    pub byte_range: Range<usize>,
+    /// The rows of `byte_range`, the end excluded
+    pub rows: Range<usize>,
+}
+
+/// The sections of `tree` that differ from `old_tree`, sorted and merged
+/// where they touch.
+///
+/// `old_tree` must have been edited to match the text of `tree`, like for
+/// [`Tree::changed_ranges`]. Changes outside of any section, e.g. to the
+/// blank line between two sections, are widened to the next section.
+pub fn changed_sections(old_tree: &Tree, tree: &Tree) -> Vec<ChangedSections> {
+    let root = tree.root_node();
+    let mut result: Vec<ChangedSections> = Vec::new();
+    for range in old_tree.changed_ranges(tree) {
+        let (mut start_byte, mut start_row) = (range.start_byte, range.start_point.row);
+        let (mut end_byte, mut end_row) = (range.end_byte, range.end_point.row + 1);
+        if let Some(first) = section_at(root, range.start_byte) {
+            start_byte = start_byte.min(first.start_byte());
+            start_row = start_row.min(first.start_position().row);
+        }
+        let last_byte = range.end_byte.saturating_sub(1).max(range.start_byte);
+        if let Some(last) = section_at(root, last_byte) {
+            end_byte = end_byte.max(last.end_byte());
+            end_row = end_row.max(last.end_position().row + 1);
+        }
+        match result.last_mut() {
+            Some(previous) if start_byte <= previous.byte_range.end => {
+                previous.byte_range.end = previous.byte_range.end.max(end_byte);
+                previous.rows.end = previous.rows.end.max(end_row);
+            }
+            _ => result.push(ChangedSections {
+                byte_range: start_byte..end_byte,
+                rows: start_row..end_row,
+            }),
+        }
+    }
+    result
+}
+
+/// The first child of `root` that ends after `byte`, which is the section
+/// containing `byte`, or the next one if `byte` is between two sections
+fn section_at(root: Node<'_>, byte: usize) -> Option<Node<'_>> {
+    let mut cursor = root.walk();
+    cursor.goto_first_child_for_byte(byte)?;
+    Some(cursor.node())
+}
+
+#[cfg(test)]
+mod test_changes {
+    use tree_sitter::{InputEdit, Parser, Point, Tree};
+
+    use super::changed_sections;
+
+    fn parse(parser: &mut Parser, text: &str, old_tree: Option<&Tree>) -> Tree {
+        parser.parse(text, old_tree).unwrap()
+    }
+
+    fn point(text: &str, byte: usize) -> Point {
+        let row = text[..byte].matches('\n').count();
+        let column = byte - text[..byte].rfind('\n').map_or(0, |newline| newline + 1);
+        Point::new(row, column)
+    }
+
+    /// Replace `old` with `new` in `text`, and reparse incrementally
+    fn replace(parser: &mut Parser, text: &str, tree: &Tree, old: &str, new: &str) -> (Tree, Tree) {
+        let start_byte = text.find(old).unwrap();
+        let new_text = text.replacen(old, new, 1);
+        let mut old_tree = tree.clone();
+        old_tree.edit(&InputEdit {
+            start_byte,
+            old_end_byte: start_byte + old.len(),
+            new_end_byte: start_byte + new.len(),
+            start_position: point(text, start_byte),
+            old_end_position: point(text, start_byte + old.len()),
+            new_end_position: point(&new_text, start_byte + new.len()),
+        });
+        let new_tree = parse(parser, &new_text, Some(&old_tree));
+        (old_tree, new_tree)
+    }
+
+    const TEXT: &str = "■┬ a.rs\n └ 1: foo\n\n■┬ b.rs\n ├ 2: bar\n └ 3: baz\n\n■┬ c.rs\n └ 4: spam";
+
+    #[test]
+    fn should_widen_changes_to_their_sections() {
+        let mut parser = Parser::new();
+        parser.set_language(&crate::language()).unwrap();
+        let tree = parse(&mut parser, TEXT, None);
+
+        let (old_tree, new_tree) = replace(&mut parser, TEXT, &tree, "bar", "barbar");
+        let new_text = TEXT.replacen("bar", "barbar", 1);
+        let changed = changed_sections(&old_tree, &new_tree);
+        assert_eq!(changed.len(), 1);
+        assert_eq!(
+            &new_text[changed[0].byte_range.clone()],
+            "■┬ b.rs\n ├ 2: barbar\n └ 3: baz"
+        );
+        assert_eq!(changed[0].rows, 3..6);
+    }
+
+    #[test]
+    fn should_not_report_identical_trees() {
+        let mut parser = Parser::new();
+        parser.set_language(&crate::language()).unwrap();
+        let tree = parse(&mut parser, TEXT, None);
+        let same = parse(&mut parser, TEXT, Some(&tree));
+        assert_eq!(changed_sections(&tree, &same), []);
+    }
+}
@@ -0,0 +1,398 @@
+//! A binary companion format that describes the structure of a quickfix
+//! document.
+//!
+//! The editor renders quickfix lists from data that is already structured,
+//! so it knows where every header and value ends up while it writes the
+//! text. [`QuickfixLayout`] records that as two tables of byte offsets, one
+//! row per section and one per value, which can be turned into a
+//! [`ViewportTree`] or a [`SectionOutline`] without tokenizing the text at
+//! all. Only the markers at the recorded offsets are checked, so a layout
+//! that does not fit the text (e.g. because the buffer was edited by hand) is
+//! rejected, and the text has to be scanned or parsed as usual.
+//!
+//! The binary encoding is little-endian and columnar:
+//!
+//! ```text
+//! "QFXL" version:u8 padding:[u8; 3]
+//! len:u32 section_count:u32 value_count:u32
+//! header_rows:[u32; section_count]
+//! header_starts:[u32; section_count]
+//! header_ends:[u32; section_count]
+//! value_counts:[u32; section_count]
+//! value_starts:[u32; value_count]
+//! value_ends:[u32; value_count]
+//! ```
+//!
+//! Starts are the offsets of the markers, and ends the offsets of the line
+//! breaks (or the end of the document).
+
+use std::{convert::TryFrom, fmt};
+
+use crate::{SectionOutline, SectionSummary};
+
+const MAGIC: &[u8; 4] = b"QFXL";
+const VERSION: u8 = 1;
+const PREAMBLE_LEN: usize = 8 + 3 * 4;
+const HEADER_MARKER: &[u8] = "■┬".as_bytes();
+const VALUE_MARKER: &[u8] = "├".as_bytes();
+const LAST_VALUE_MARKER: &[u8] = "└".as_bytes();
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum LayoutError {
+    /// The bytes are not an encoded layout of a supported version
+    Malformed,
+    /// The layout was made for a document of another length
+    LengthMismatch { expected: usize, actual: usize },
+    /// The text at `byte` does not match the layout
+    Mismatch { byte: usize },
+}
+
+impl fmt::Display for LayoutError {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        match self {
+            LayoutError::Malformed => write!(f, "malformed quickfix layout"),
+            LayoutError::LengthMismatch { expected, actual } => write!(
+                f,
+                "quickfix layout is for {expected} bytes, but the text has {actual} bytes"
+            ),
+            LayoutError::Mismatch { byte } => {
+                write!(f, "quickfix layout does not match the text at byte {byte}")
+            }
+        }
+    }
+}
+
+impl std::error::Error for LayoutError {}
+
+/// The section and value tables of a quickfix document, see the
+/// [module documentation](self).
+#[derive(Debug, Clone, Default, PartialEq, Eq)]
+pub struct QuickfixLayout {
+    len: u32,
+    header_rows: Vec<u32>,
+    header_starts: Vec<u32>,
+    header_ends: Vec<u32>,
+    value_counts: Vec<u32>,
+    value_starts: Vec<u32>,
+    value_ends: Vec<u32>,
+}
+
+fn offset(value: usize) -> u32 {
+    u32::try_from(value).expect("quickfix documents are smaller than 4 GiB")
+}
+
+impl QuickfixLayout {
+    /// Record a header line at `row`, whose `■┬` marker starts at
+    /// `marker_start` and whose line ends at `line_end`.
+    pub fn push_header(&mut self, row: usize, marker_start: usize, line_end: usize) {
+        self.header_rows.push(offset(row));
+        self.header_starts.push(offset(marker_start));
+        self.header_ends.push(offset(line_end));
+        self.value_counts.push(0);
+    }
+
+    /// Record a value line of the last header. The last value of every
+    /// section is expected to be a `lastValue`.
+    pub fn push_value(&mut self, marker_start: usize, line_end: usize) {
+        debug_assert!(!self.value_counts.is_empty(), "value without a header");
+        if let Some(count) = self.value_counts.last_mut() {
+            *count += 1
+        }
+        self.value_starts.push(offset(marker_start));
+        self.value_ends.push(offset(line_end));
+    }
+
+    /// Set the byte length of the whole document
+    pub fn set_len(&mut self, len: usize) {
+        self.len = offset(len)
+    }
+
+    pub fn len(&self) -> usize {
+        self.len as usize
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.len == 0
+    }
+
+    pub fn section_count(&self) -> usize {
+        self.header_starts.len()
+    }
+
+    pub fn value_count(&self) -> usize {
+        self.value_starts.len()
+    }
+
+    fn columns(&self) -> [&Vec<u32>; 6] {
+        [
+            &self.header_rows,
+            &self.header_starts,
+            &self.header_ends,
+            &self.value_counts,
+            &self.value_starts,
+            &self.value_ends,
+        ]
+    }
+
+    pub fn to_bytes(&self) -> Vec<u8> {
+        let mut bytes = Vec::with_capacity(
+            PREAMBLE_LEN + 4 * (4 * self.section_count() + 2 * self.value_count()),
+        );
+        bytes.extend_from_slice(MAGIC);
+        bytes.extend_from_slice(&[VERSION, 0, 0, 0]);
+        for value in [
+            self.len,
+            offset(self.section_count()),
+            offset(self.value_count()),
+        ] {
+            bytes.extend_from_slice(&value.to_le_bytes())
+        }
+        for column in self.columns() {
+            for value in column {
+                bytes.extend_from_slice(&value.to_le_bytes())
+            }
+        }
+        bytes
+    }
+
+    pub fn from_bytes(bytes: &[u8]) -> Result<Self, LayoutError> {
+        if bytes.len() < PREAMBLE_LEN || &bytes[..4] != MAGIC || bytes[4] != VERSION {
+            return Err(LayoutError::Malformed);
+        }
+        let mut words = bytes[8..]
+            .chunks_exact(4)
+            .map(|chunk| u32::from_le_bytes([chunk[0], chunk[1], chunk[2], chunk[3]]));
+        let (Some(len), Some(section_count), Some(value_count)) =
+            (words.next(), words.next(), words.next())
+        else {
+            return Err(LayoutError::Malformed);
+        };
+        let expected_len = (section_count as u64 * 4 + value_count as u64 * 2) * 4;
+        if (bytes.len() - PREAMBLE_LEN) as u64 != expected_len {
+            return Err(LayoutError::Malformed);
+        }
+        let mut column = |count: u32| words.by_ref().take(count as usize).collect::<Vec<_>>();
+        Ok(Self {
+            len,
+            header_rows: column(section_count),
+            header_starts: column(section_count),
+            header_ends: column(section_count),
+            value_counts: column(section_count),
+            value_starts: column(value_count),
+            value_ends: column(value_count),
+        })
+    }
+
+    /// Check the layout against `text`, looking only at the recorded offsets.
+    pub(crate) fn validate(&self, text: &str) -> Result<(), LayoutError> {
+        let bytes = text.as_bytes();
+        if self.len() != bytes.len() {
+            return Err(LayoutError::LengthMismatch {
+                expected: self.len(),
+                actual: bytes.len(),
+            });
+        }
+        let value_total = self
+            .value_counts
+            .iter()
+            .map(|count| *count as u64)
+            .sum::<u64>();
+        if value_total != self.value_count() as u64 {
+            return Err(LayoutError::Malformed);
+        }
+        let mut previous_end = None::<usize>;
+        let mut previous_row = None::<u32>;
+        let mut check_line = |start: usize, end: usize, marker: &[u8], needs_newline: bool| {
+            let mismatch = Err(LayoutError::Mismatch { byte: start });
+            // Lines are ordered and do not overlap
+            if previous_end.map_or(false, |previous_end| start <= previous_end) {
+                return mismatch;
+            }
+            previous_end = Some(end);
+            // The marker is followed by a non-empty word
+            if end > bytes.len()
+                || start + marker.len() >= end
+                || !bytes[start..].starts_with(marker)
+            {
+                return mismatch;
+            }
+            match bytes.get(end) {
+                Some(b'\n') => Ok(()),
+                None if !needs_newline => Ok(()),
+                _ => mismatch,
+            }
+        };
+        let mut values = self.value_starts.iter().zip(&self.value_ends);
+        for (section, count) in self.value_counts.iter().enumerate() {
+            let row = self.header_rows[section];
+            if *count == 0 || previous_row.map_or(false, |previous_row| row <= previous_row) {
+                return Err(LayoutError::Mismatch {
+                    byte: self.header_starts[section] as usize,
+                });
+            }
+            previous_row = Some(row);
+            check_line(
+                self.header_starts[section] as usize,
+                self.header_ends[section] as usize,
+                HEADER_MARKER,
+                true,
+            )?;
+            for index in 0..*count {
+                let (start, end) = values.next().ok_or(LayoutError::Malformed)?;
+                let last = index + 1 == *count;
+                let marker = if last {
+                    LAST_VALUE_MARKER
+                } else {
+                    VALUE_MARKER
+                };
+                check_line(*start as usize, *end as usize, marker, !last)?;
+            }
+        }
+        Ok(())
+    }
+
+    /// The row and marker offset of the header of every section
+    pub(crate) fn headers(&self) -> impl Iterator<Item = (usize, usize)> + '_ {
+        self.header_rows
+            .iter()
+            .zip(&self.header_starts)
+            .map(|(row, start)| (*row as usize, *start as usize))
+    }
+}
+
+impl SectionOutline {
+    /// The outline of the document described by `layout`, read off its
+    /// columns without looking at the text.
+    pub fn from_layout(layout: &QuickfixLayout) -> Self {
+        let mut value_lines = layout.value_starts.iter().zip(&layout.value_ends);
+        let sections = (0..layout.section_count())
+            .map(|section| {
+                let start = layout.header_starts[section] as usize;
+                let header_end = layout.header_ends[section] as usize;
+                let value_count = layout.value_counts[section] as usize;
+                let mut values = value_lines
+                    .by_ref()
+                    .take(value_count)
+                    .map(|(start, end)| (*start as usize, *end as usize));
+                let values_byte_range = match values.next() {
+                    Some((first_start, first_end)) => {
+                        first_start..values.last().map_or(first_end, |(_, end)| end)
+                    }
+                    None => header_end..header_end,
+                };
+                SectionSummary {
+                    byte_range: start..values_byte_range.end,
+                    start_row: layout.header_rows[section] as usize,
+                    values_byte_range,
+                    value_count,
+                }
+            })
+            .collect();
+        SectionOutline::from_sections(sections)
+    }
+}
+
+#[cfg(test)]
+mod test_columnar {
+    use super::{LayoutError, QuickfixLayout};
+    use crate::{SectionOutline, ViewportTree};
+
+    /// Render sections the way the editor does, recording the layout
+    fn render(sections: &[(&str, &[&str])]) -> (String, QuickfixLayout) {
+        let mut text = String::new();
+        let mut layout = QuickfixLayout::default();
+        let mut row = 0;
+        for (index, (header, values)) in sections.iter().enumerate() {
+            if index > 0 {
+                text.push_str("\n\n");
+                row += 2;
+            }
+            let start = text.len();
+            text.push_str(&format!("■┬ {header}"));
+            layout.push_header(row, start, text.len());
+            for (index, value) in values.iter().enumerate() {
+                text.push_str("\n ");
+                row += 1;
+                let start = text.len();
+                let marker = if index + 1 == values.len() {
+                    "└"
+                } else {
+                    "├"
+                };
+                text.push_str(&format!("{marker}─ {value}"));
+                layout.push_value(start, text.len());
+            }
+        }
+        layout.set_len(text.len());
+        (text, layout)
+    }
+
+    #[test]
+    fn should_outline_like_the_tree() {
+        let (text, layout) = render(&[
+            ("src/main.rs", &["1:1  fn main() {}", "3:5  └ inside"]),
+            ("src/lib.rs", &["10:2  ■┬ mod a;"]),
+        ]);
+        let mut parser = tree_sitter::Parser::new();
+        parser.set_language(&crate::language()).unwrap();
+        let tree = parser.parse(&text, None).unwrap();
+        assert!(!tree.root_node().has_error());
+        assert_eq!(
+            SectionOutline::from_layout(&layout),
+            SectionOutline::new(&tree)
+        );
+    }
+
+    #[test]
+    fn should_round_trip_through_bytes() {
+        let (_, layout) = render(&[("a", &["1", "2"]), ("b", &["3"])]);
+        let bytes = layout.to_bytes();
+        assert_eq!(QuickfixLayout::from_bytes(&bytes), Ok(layout));
+        assert_eq!(
+            QuickfixLayout::from_bytes(&bytes[..bytes.len() - 1]),
+            Err(LayoutError::Malformed)
+        );
+        assert_eq!(
+            QuickfixLayout::from_bytes(b"QFXL"),
+            Err(LayoutError::Malformed)
+        );
+    }
+
+    #[test]
+    fn should_reject_layout_of_other_text() {
+        let (text, layout) = render(&[("a", &["1", "2"]), ("b", &["3"])]);
+        let edited = text.replacen("├", "x", 1);
+        assert!(matches!(
+            layout.validate(&edited),
+            Err(LayoutError::LengthMismatch { .. })
+        ));
+        let edited = text.replacen("├", "└", 1);
+        assert_eq!(
+            layout.validate(&edited),
+            Err(LayoutError::Mismatch {
+                byte: text.find('├').unwrap()
+            })
+        );
+        assert!(ViewportTree::from_layout(&edited, &layout, 0).is_err());
+    }
+
+    #[test]
+    fn should_find_sections_of_viewport_tree() {
+        let sections = (0..50)
+            .map(|i| (format!("file_{i}.rs"), ["1: foo", "2: bar"]))
+            .collect::<Vec<_>>();
+        let sections = sections
+            .iter()
+            .map(|(header, values)| (header.as_str(), &values[..]))
+            .collect::<Vec<_>>();
+        let (text, layout) = render(&sections);
+        let from_layout = ViewportTree::from_layout(&text, &layout, 2).unwrap();
+        let from_text = ViewportTree::new(&text, 2);
+        let bytes = text.as_bytes();
+        let mut input = |byte: usize, _: tree_sitter::Point| bytes.get(byte..).unwrap_or_default();
+        for mut viewport in [from_layout, from_text] {
+            assert!(viewport.ensure_visible(40..50, &mut input));
+            assert_eq!(viewport.parsed_rows(), [36..52]);
+        }
+    }
+}
@@ -0,0 +1,137 @@
+//! Highlighting quickfix trees with `queries/highlights.scm`.
+//!
+//! The query is compiled once per process by [`highlights_query`], and
+//! [`highlight_changed`] only runs it over the parts of a tree that changed
+//! since the previous tree, as reported by `ts_tree_get_changed_ranges`.
+
+use std::{ops::Range, sync::OnceLock};
+
+use tree_sitter::{Query, QueryCursor, Tree};
+
+/// The compiled [`crate::HIGHLIGHTS_QUERY`]
+pub fn highlights_query() -> &'static Query {
+    static QUERY: OnceLock<Query> = OnceLock::new();
+    QUERY.get_or_init(|| {
+        Query::new(&crate::language(), crate::HIGHLIGHTS_QUERY)
+            .expect("Error compiling the quickfix highlights query")
+    })
+}
+
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct HighlightSpan {
+    pub byte_range: Range<usize>,
+    /// Index into `highlights_query().capture_names()`
+    pub capture_index: u32,
+}
+
+#[derive(Debug, Clone, Default, PartialEq, Eq)]
+pub struct ChangedHighlights {
+    /// The byte ranges that were highlighted. Highlights of the previous tree
+    /// overlapping these ranges are stale, the others are still valid.
+    pub changed_ranges: Vec<Range<usize>>,
+    /// Sorted by position
+    pub spans: Vec<HighlightSpan>,
+}
+
+/// Highlight the parts of `tree` that differ from `old_tree`, or the whole
+/// of `tree` if there is no `old_tree`.
+///
+/// `old_tree` must have been edited to match the text of `tree`, like for
+/// [`Tree::changed_ranges`].
+pub fn highlight_changed(tree: &Tree, old_tree: Option<&Tree>) -> ChangedHighlights {
+    let changed_ranges = match old_tree {
+        Some(old_tree) => old_tree
+            .changed_ranges(tree)
+            .map(|range| range.start_byte..range.end_byte)
+            .collect::<Vec<_>>(),
+        None => vec![tree.root_node().byte_range()],
+    };
+    let query = highlights_query();
+    let mut cursor = QueryCursor::new();
+    let mut spans = Vec::new();
+    for range in &changed_ranges {
+        cursor.set_byte_range(range.clone());
+        // The query has no predicates, so the text is never read
+        let text: &[u8] = &[];
+        for (query_match, capture_index) in cursor.captures(query, tree.root_node(), text) {
+            let capture = query_match.captures[capture_index];
+            spans.push(HighlightSpan {
+                byte_range: capture.node.byte_range(),
+                capture_index: capture.index,
+            })
+        }
+    }
+    // Nodes spanning two adjacent changed ranges are captured twice
+    spans.sort_by_key(|span| {
+        (
+            span.byte_range.start,
+            span.byte_range.end,
+            span.capture_index,
+        )
+    });
+    spans.dedup();
+    ChangedHighlights {
+        changed_ranges,
+        spans,
+    }
+}
+
+#[cfg(test)]
+mod test_highlight {
+    use tree_sitter::{Parser, Point};
+
+    use super::{highlight_changed, highlights_query};
+
+    fn highlights(text: &str, spans: &[super::HighlightSpan]) -> Vec<(String, String)> {
+        spans
+            .iter()
+            .map(|span| {
+                (
+                    text[span.byte_range.clone()].to_string(),
+                    highlights_query().capture_names()[span.capture_index as usize].to_string(),
+                )
+            })
+            .collect()
+    }
+
+    #[test]
+    fn should_highlight_changed_sections_only() {
+        let text = "■┬ a.rs\n └ 1: foo\n\n■┬ b.rs\n └ 2: bar";
+        let mut parser = Parser::new();
+        parser.set_language(&crate::language()).unwrap();
+        let tree = parser.parse(text, None).unwrap();
+        let all = highlight_changed(&tree, None);
+        assert_eq!(
+            highlights(text, &all.spans),
+            [
+                ("■┬", "punctuation.special"),
+                (" a.rs", "string.special.path"),
+                ("└", "punctuation.delimiter"),
+                (" 1: foo", "string"),
+                ("■┬", "punctuation.special"),
+                (" b.rs", "string.special.path"),
+                ("└", "punctuation.delimiter"),
+                (" 2: bar", "string"),
+            ]
+            .map(|(text, name)| (text.to_string(), name.to_string()))
+        );
+
+        // Replace "bar" with "spam"
+        let new_text = "■┬ a.rs\n └ 1: foo\n\n■┬ b.rs\n └ 2: spam";
+        let start_byte = text.len() - 3;
+        let mut old_tree = tree.clone();
+        old_tree.edit(&tree_sitter::InputEdit {
+            start_byte,
+            old_end_byte: text.len(),
+            new_end_byte: new_text.len(),
+            start_position: Point::new(4, 6),
+            old_end_position: Point::new(4, 9),
+            new_end_position: Point::new(4, 10),
+        });
+        let new_tree = parser.parse(new_text, Some(&old_tree)).unwrap();
+        let changed = highlight_changed(&new_tree, Some(&old_tree));
+        let highlighted = highlights(new_text, &changed.spans);
+        assert!(highlighted.contains(&(" 2: spam".to_string(), "string".to_string())));
+        assert!(!highlighted.iter().any(|(text, _)| text == " a.rs"));
+    }
+}
@@ -15,7 +15,30 @@
 //! [Parser]: https://docs.rs/tree-sitter/*/tree_sitter/struct.Parser.html
 //! [tree-sitter]: https://tree-sitter.github.io/
 
+mod budget;
+mod cache;
+mod changes;
+mod columnar;
+mod highlight;
+mod mapped;
+mod outline;
+mod parallel;
+mod pool;
+mod stats;
+mod viewport;
+
+pub use budget::{BudgetedParser, CancelHandle, ParseOutcome};
+pub use cache::{ContentKey, TreeCache};
+pub use changes::{changed_sections, ChangedSections};
+pub use columnar::{LayoutError, QuickfixLayout};
+pub use highlight::{highlight_changed, highlights_query, ChangedHighlights, HighlightSpan};
+pub use mapped::MappedTree;
+pub use outline::{SectionOutline, SectionSummary};
+pub use parallel::parse_many;
+pub use pool::{parser, ParserPool, PooledParser};
+pub use stats::{counters, CountersSnapshot, InstrumentedParser, ParseCounters, ParseStats};
 use tree_sitter::Language;
+pub use viewport::{ViewportProgress, ViewportTree};
 
 extern "C" {
     fn tree_sitter_quickfix() -> Language;
@@ -33,13 +56,25 @@ pub fn language() -> Language {
 /// [`node-types.json`]: https://tree-sitter.github.io/tree-sitter/using-parsers#static-node-types
 pub const NODE_TYPES: &str = include_str!("../../src/node-types.json");
 
+/// The highlights query for this grammar, see also [`highlights_query`].
+pub const HIGHLIGHTS_QUERY: &str = include_str!("../../queries/highlights.scm");
+
 // Uncomment these to include any queries that this grammar contains
 
-// pub const HIGHLIGHTS_QUERY: &'static str = include_str!("../../queries/highlights.scm");
 // pub const INJECTIONS_QUERY: &'static str = include_str!("../../queries/injections.scm");
 // pub const LOCALS_QUERY: &'static str = include_str!("../../queries/locals.scm");
 // pub const TAGS_QUERY: &'static str = include_str!("../../queries/tags.scm");
 
+/// A document of `sections` sections with two values each, shared by the
+/// tests of the modules
+#[cfg(test)]
+fn document(sections: usize) -> String {
+    (0..sections)
+        .map(|i| format!("■┬ file_{i}.rs\n ├ 1: foo\n └ 2: bar"))
+        .collect::<Vec<_>>()
+        .join("\n\n")
+}
+
 #[cfg(test)]
 mod tests {
     #[test]
@@ -49,4 +84,39 @@ mod tests {
             .set_language(&super::language())
             .expect("Error loading quickfix language");
     }
+
+    #[test]
+    fn test_markers_within_a_line_are_part_of_the_word() {
+        let code = "■┬ src/■┬.rs\n ├ 1: \"├ a\"\n └ 2: └ b ■┬ c";
+        let mut parser = tree_sitter::Parser::new();
+        parser
+            .set_language(&super::language())
+            .expect("Error loading quickfix language");
+        let tree = parser.parse(code, None).unwrap();
+        assert!(!tree.root_node().has_error());
+        let section = tree.root_node().child(0).unwrap();
+        assert_eq!(section.end_byte(), code.len());
+        assert_eq!(tree.root_node().named_child_count(), 1);
+    }
+
+    #[test]
+    fn test_escaped_line_breaks_are_part_of_the_word() {
+        // How the editor renders line breaks within group keys and items, see
+        // `escape_line_breaks` in `src/components/dropdown.rs`
+        let code = "■┬ src/\\nmain.rs\n ├─ let x = 1;\\n└─ b\n └─ a\\n■┬ c";
+        let mut parser = tree_sitter::Parser::new();
+        parser
+            .set_language(&super::language())
+            .expect("Error loading quickfix language");
+        let tree = parser.parse(code, None).unwrap();
+        assert!(!tree.root_node().has_error());
+        assert_eq!(tree.root_node().named_child_count(), 1);
+        let section = tree.root_node().child(0).unwrap();
+        let header = section.named_child(0).unwrap();
+        let word = header.named_child(0).unwrap();
+        assert_eq!(word.utf8_text(code.as_bytes()), Ok(" src/\\nmain.rs"));
+        let values = section.named_child(1).unwrap();
+        assert_eq!(values.kind(), "values");
+        assert_eq!(values.named_child_count(), 2);
+    }
 }
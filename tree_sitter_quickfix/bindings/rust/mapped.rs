@@ -0,0 +1,94 @@
+//! Parsing quickfix lists that are persisted to disk.
+//!
+//! Quickfix dumps of large repositories can be hundreds of MB, so instead of
+//! reading them into a `String`, the file is memory-mapped and the parser
+//! reads straight from the mapping. The mapped pages are backed by the file,
+//! so the kernel can drop them under memory pressure, which keeps the
+//! resident memory close to the size of the tree alone.
+
+use std::{fs::File, io, path::Path};
+
+use memmap2::Mmap;
+use tree_sitter::{Parser, Tree};
+
+/// A tree parsed from a memory-mapped file, together with the mapping so
+/// that the text of its nodes can still be read.
+pub struct MappedTree {
+    /// `None` for empty files, which cannot be mapped on every platform
+    mmap: Option<Mmap>,
+    tree: Tree,
+}
+
+impl MappedTree {
+    /// Map the file at `path` and parse it with the quickfix language.
+    ///
+    /// The file must not be modified while it is mapped, see
+    /// [`Mmap::map`].
+    pub fn parse_file(path: impl AsRef<Path>) -> io::Result<Self> {
+        let file = File::open(path)?;
+        let mmap = if file.metadata()?.len() == 0 {
+            None
+        } else {
+            let mmap = unsafe { Mmap::map(&file)? };
+            // The parser reads the file from start to end exactly once
+            #[cfg(unix)]
+            let _ = mmap.advise(memmap2::Advice::Sequential);
+            Some(mmap)
+        };
+
+        let mut parser = Parser::new();
+        parser
+            .set_language(&crate::language())
+            .expect("Error loading quickfix language");
+        let text: &[u8] = mmap.as_deref().unwrap_or_default();
+        let tree = parser
+            .parse_with(&mut |byte, _| text.get(byte..).unwrap_or_default(), None)
+            .ok_or_else(|| io::Error::new(io::ErrorKind::Other, "Parsing was cancelled"))?;
+        Ok(Self { mmap, tree })
+    }
+
+    /// The content of the file, as seen by the parser
+    pub fn text(&self) -> &[u8] {
+        self.mmap.as_deref().unwrap_or_default()
+    }
+
+    pub fn tree(&self) -> &Tree {
+        &self.tree
+    }
+
+    /// Unmap the file and keep the tree only
+    pub fn into_tree(self) -> Tree {
+        self.tree
+    }
+}
+
+#[cfg(test)]
+mod test_mapped {
+    use std::io::Write;
+
+    use super::MappedTree;
+
+    #[test]
+    fn should_parse_mapped_file() -> std::io::Result<()> {
+        let text = "■┬ a.rs\n ├ 1: foo\n └ 2: bar\n\n■┬ b.rs\n └ 3: spam";
+        let mut file = tempfile::NamedTempFile::new()?;
+        file.write_all(text.as_bytes())?;
+        let mapped = MappedTree::parse_file(file.path())?;
+        assert_eq!(mapped.text(), text.as_bytes());
+        let root = mapped.tree().root_node();
+        assert!(!root.has_error());
+        assert_eq!(root.named_child_count(), 2);
+        let header = root.child(1).unwrap().child(0).unwrap();
+        assert_eq!(header.utf8_text(mapped.text()).unwrap(), "■┬ b.rs");
+        Ok(())
+    }
+
+    #[test]
+    fn should_parse_empty_file() -> std::io::Result<()> {
+        let file = tempfile::NamedTempFile::new()?;
+        let mapped = MappedTree::parse_file(file.path())?;
+        assert!(mapped.text().is_empty());
+        assert_eq!(mapped.into_tree().root_node().kind(), "source_file");
+        Ok(())
+    }
+}
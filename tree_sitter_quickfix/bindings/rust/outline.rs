@@ -0,0 +1,187 @@
+//! Per-section summaries of a quickfix document.
+//!
+//! Moving to the next or previous file of a quickfix list, or finding the
+//! section of the highlighted line, only needs to know where every section
+//! starts and how many values it has. [`SectionOutline`] keeps exactly that,
+//! sorted by position, so that these lookups are binary searches over the
+//! sections instead of walks over every value. It is read off the `values`
+//! child of every `section` node, which tree-sitter summarizes while
+//! parsing, so building it does not visit any value either.
+
+use std::ops::Range;
+
+use tree_sitter::{Node, Tree};
+
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct SectionSummary {
+    /// The byte range of the `section` node, from its `■┬` marker to the
+    /// end of its last value
+    pub byte_range: Range<usize>,
+    /// The row of the header
+    pub start_row: usize,
+    /// The byte range of the `values` node
+    pub values_byte_range: Range<usize>,
+    pub value_count: usize,
+}
+
+impl SectionSummary {
+    /// The summary of a `section` node, or `None` if the node has no
+    /// `values`, e.g. when it is `MISSING`.
+    pub fn of(section: Node<'_>) -> Option<Self> {
+        // A section only has a header and its values, unless it has errors
+        let mut cursor = section.walk();
+        let values = section
+            .named_children(&mut cursor)
+            .find(|child| child.kind() == "values")?;
+        Some(Self {
+            byte_range: section.byte_range(),
+            start_row: section.start_position().row,
+            values_byte_range: values.byte_range(),
+            value_count: values.named_child_count(),
+        })
+    }
+}
+
+/// The [`SectionSummary`] of every section of a document, in document order.
+#[derive(Debug, Clone, Default, PartialEq, Eq)]
+pub struct SectionOutline {
+    sections: Vec<SectionSummary>,
+}
+
+impl SectionOutline {
+    pub(crate) fn from_sections(sections: Vec<SectionSummary>) -> Self {
+        Self { sections }
+    }
+
+    /// The outline of a tree parsed with [`language`](crate::language).
+    /// Only the children of the root are visited.
+    pub fn new(tree: &Tree) -> Self {
+        let mut cursor = tree.walk();
+        let sections = tree
+            .root_node()
+            .named_children(&mut cursor)
+            .filter(|node| node.kind() == "section")
+            .filter_map(SectionSummary::of)
+            .collect();
+        Self { sections }
+    }
+
+    pub fn sections(&self) -> &[SectionSummary] {
+        &self.sections
+    }
+
+    pub fn len(&self) -> usize {
+        self.sections.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.sections.is_empty()
+    }
+
+    /// The index of the section that `byte` is in, i.e. the last section
+    /// that starts at or before `byte`. The blank line after a section
+    /// belongs to it.
+    pub fn section_at_byte(&self, byte: usize) -> Option<usize> {
+        self.sections
+            .partition_point(|section| section.byte_range.start <= byte)
+            .checked_sub(1)
+    }
+
+    /// Like [`SectionOutline::section_at_byte`], but by row
+    pub fn section_at_row(&self, row: usize) -> Option<usize> {
+        self.sections
+            .partition_point(|section| section.start_row <= row)
+            .checked_sub(1)
+    }
+
+    /// The first section that starts after `byte`
+    pub fn next_section(&self, byte: usize) -> Option<&SectionSummary> {
+        let index = self
+            .sections
+            .partition_point(|section| section.byte_range.start <= byte);
+        self.sections.get(index)
+    }
+
+    /// The section before the one that `byte` is in
+    pub fn previous_section(&self, byte: usize) -> Option<&SectionSummary> {
+        let index = self.section_at_byte(byte)?.checked_sub(1)?;
+        self.sections.get(index)
+    }
+}
+
+#[cfg(test)]
+mod test_outline {
+    use super::SectionOutline;
+
+    const EXAMPLE: &str = "■┬ event/src/lib.rs
+ ├ 5: pub(crate) use crate::event::{KeyEvent, KeyModifiers};
+ └ 97: use crate::{KeyEvent, KeyModifiers};
+
+■┬ shared/src/formatter.rs
+ └ 3: use crate::language::ProcessCommand;
+
+■┬ src/app.rs
+ ├ 1: use crate::{
+ ├ 2:     buffer::Buffer,
+ └ 3:     components::editor::Editor,";
+
+    fn parse(text: &str) -> tree_sitter::Tree {
+        let mut parser = tree_sitter::Parser::new();
+        parser.set_language(&crate::language()).unwrap();
+        parser.parse(text, None).unwrap()
+    }
+
+    #[test]
+    fn should_summarize_sections() {
+        let outline = SectionOutline::new(&parse(EXAMPLE));
+        assert_eq!(
+            outline
+                .sections()
+                .iter()
+                .map(|section| (section.start_row, section.value_count))
+                .collect::<Vec<_>>(),
+            [(0, 2), (4, 1), (7, 3)]
+        );
+        let second = &outline.sections()[1];
+        assert_eq!(
+            &EXAMPLE[second.values_byte_range.clone()],
+            "└ 3: use crate::language::ProcessCommand;"
+        );
+        assert_eq!(
+            &EXAMPLE[second.byte_range.clone()],
+            "■┬ shared/src/formatter.rs\n └ 3: use crate::language::ProcessCommand;"
+        );
+    }
+
+    #[test]
+    fn should_find_sections_by_binary_search() {
+        let outline = SectionOutline::new(&parse(EXAMPLE));
+        let starts = outline
+            .sections()
+            .iter()
+            .map(|section| section.byte_range.start)
+            .collect::<Vec<_>>();
+        let byte = EXAMPLE.find("ProcessCommand").unwrap();
+        assert_eq!(outline.section_at_byte(byte), Some(1));
+        assert_eq!(outline.section_at_byte(starts[1]), Some(1));
+        assert_eq!(outline.section_at_byte(starts[1] - 1), Some(0));
+        assert_eq!(outline.section_at_row(6), Some(1));
+        assert_eq!(outline.section_at_row(100), Some(2));
+
+        assert_eq!(
+            outline.next_section(byte).unwrap().byte_range.start,
+            starts[2]
+        );
+        assert_eq!(outline.next_section(starts[2]), None);
+        assert_eq!(
+            outline.previous_section(byte).unwrap().byte_range.start,
+            starts[0]
+        );
+        assert_eq!(outline.previous_section(starts[0]), None);
+
+        let empty = SectionOutline::new(&parse(""));
+        assert!(empty.is_empty());
+        assert_eq!(empty.section_at_byte(0), None);
+        assert_eq!(empty.next_section(0), None);
+    }
+}
@@ -0,0 +1,86 @@
+//! Parsing many quickfix documents at once.
+//!
+//! `tree_sitter::Parser` is not `Sync`, but it is cheap enough to create one
+//! per worker thread, so documents are distributed over a small pool of
+//! scoped threads that each own a parser.
+
+use std::{
+    num::NonZeroUsize,
+    sync::atomic::{AtomicUsize, Ordering},
+};
+
+use tree_sitter::{Parser, Tree};
+
+/// Parse every document of `documents` with the quickfix language, using up
+/// to one thread per available core. The trees are returned in the same
+/// order as `documents`.
+pub fn parse_many<T: AsRef<[u8]> + Sync>(documents: &[T]) -> Vec<Option<Tree>> {
+    let thread_count = std::thread::available_parallelism()
+        .map(NonZeroUsize::get)
+        .unwrap_or(1)
+        .min(documents.len());
+    parse_many_with_threads(documents, thread_count)
+}
+
+pub(crate) fn parse_many_with_threads<T: AsRef<[u8]> + Sync>(
+    documents: &[T],
+    thread_count: usize,
+) -> Vec<Option<Tree>> {
+    let next_document = AtomicUsize::new(0);
+    let work = || {
+        let mut parser = Parser::new();
+        parser
+            .set_language(&crate::language())
+            .expect("Error loading quickfix language");
+        let mut trees = Vec::new();
+        loop {
+            let index = next_document.fetch_add(1, Ordering::Relaxed);
+            let Some(document) = documents.get(index) else {
+                return trees;
+            };
+            trees.push((index, parser.parse(document, None)));
+        }
+    };
+
+    let mut result: Vec<Option<Tree>> = (0..documents.len()).map(|_| None).collect();
+    if thread_count <= 1 {
+        for (index, tree) in work() {
+            result[index] = tree
+        }
+        return result;
+    }
+    std::thread::scope(|scope| {
+        let handles = (0..thread_count)
+            .map(|_| scope.spawn(work))
+            .collect::<Vec<_>>();
+        for handle in handles {
+            for (index, tree) in handle.join().expect("Parser thread panicked") {
+                result[index] = tree
+            }
+        }
+    });
+    result
+}
+
+#[cfg(test)]
+mod test_parallel {
+    use super::parse_many_with_threads;
+
+    #[test]
+    fn should_parse_documents_in_order() {
+        let documents = (0..20)
+            .map(|i| {
+                let values = " ├ 1: foo\n".repeat(i);
+                format!("■┬ file_{i}.rs\n{values} └ 2: bar")
+            })
+            .collect::<Vec<_>>();
+        let trees = parse_many_with_threads(&documents, 4);
+        assert_eq!(trees.len(), documents.len());
+        for (i, tree) in trees.into_iter().enumerate() {
+            let tree = tree.unwrap();
+            assert!(!tree.root_node().has_error());
+            let values = tree.root_node().child(0).unwrap().child(1).unwrap();
+            assert_eq!(values.named_child_count(), i + 1);
+        }
+    }
+}
@@ -0,0 +1,164 @@
+//! Reusing parsers of the quickfix language.
+//!
+//! Every quickfix buffer, such as the one of a dropdown, needs a parser, and
+//! dropdowns come and go all the time. A [`ParserPool`] hands out parsers
+//! that already have their language set, and takes them back when they are
+//! dropped, so that the memory of their parse stacks, which grows to fit the
+//! largest document parsed so far, is reused rather than allocated again.
+
+use std::{
+    ops::{Deref, DerefMut},
+    sync::{Mutex, OnceLock},
+};
+
+use tree_sitter::{Language, Parser};
+
+/// How many idle parsers the pool of [`parser`] keeps. More than a handful
+/// are rarely in use at the same time.
+const DEFAULT_CAPACITY: usize = 8;
+
+pub struct ParserPool {
+    language: Language,
+    capacity: usize,
+    idle: Mutex<Vec<Parser>>,
+}
+
+/// A parser of a [`ParserPool`], which returns to the pool when dropped.
+pub struct PooledParser<'a> {
+    // Only `None` while being dropped
+    parser: Option<Parser>,
+    pool: &'a ParserPool,
+}
+
+impl ParserPool {
+    /// A pool of parsers of `language` that keeps at most `capacity` idle
+    /// parsers. Parsers returned to a full pool are dropped.
+    pub fn new(language: Language, capacity: usize) -> Self {
+        Self {
+            language,
+            capacity,
+            idle: Mutex::new(Vec::new()),
+        }
+    }
+
+    pub fn language(&self) -> &Language {
+        &self.language
+    }
+
+    /// An idle parser of the pool, or a new one if there is none
+    pub fn get(&self) -> PooledParser<'_> {
+        let parser = self.idle().pop().unwrap_or_else(|| {
+            let mut parser = Parser::new();
+            parser
+                .set_language(&self.language)
+                .expect("Error loading quickfix language");
+            parser
+        });
+        PooledParser {
+            parser: Some(parser),
+            pool: self,
+        }
+    }
+
+    /// How many parsers are waiting to be reused
+    pub fn idle_count(&self) -> usize {
+        self.idle().len()
+    }
+
+    fn idle(&self) -> std::sync::MutexGuard<'_, Vec<Parser>> {
+        // The list stays valid even if a thread panicked while holding it
+        self.idle
+            .lock()
+            .unwrap_or_else(|poisoned| poisoned.into_inner())
+    }
+
+    fn put_back(&self, mut parser: Parser) {
+        // Undo whatever the borrower configured, but keep the language and
+        // the allocations. `reset` drops an unfinished parse, if any.
+        parser.reset();
+        parser.set_timeout_micros(0);
+        parser.set_logger(None);
+        // SAFETY: clearing the flag cannot leave a dangling pointer behind
+        unsafe { parser.set_cancellation_flag(None) };
+        if parser.set_included_ranges(&[]).is_err() {
+            return;
+        }
+        let mut idle = self.idle();
+        if idle.len() < self.capacity {
+            idle.push(parser)
+        }
+    }
+}
+
+impl Deref for PooledParser<'_> {
+    type Target = Parser;
+
+    fn deref(&self) -> &Parser {
+        self.parser.as_ref().expect("Parser was taken")
+    }
+}
+
+impl DerefMut for PooledParser<'_> {
+    fn deref_mut(&mut self) -> &mut Parser {
+        self.parser.as_mut().expect("Parser was taken")
+    }
+}
+
+impl Drop for PooledParser<'_> {
+    fn drop(&mut self) {
+        if let Some(parser) = self.parser.take() {
+            self.pool.put_back(parser)
+        }
+    }
+}
+
+/// A parser of [`language`](crate::language) from a pool shared by the
+/// whole process.
+pub fn parser() -> PooledParser<'static> {
+    static POOL: OnceLock<ParserPool> = OnceLock::new();
+    POOL.get_or_init(|| ParserPool::new(crate::language(), DEFAULT_CAPACITY))
+        .get()
+}
+
+#[cfg(test)]
+mod test_pool {
+    use super::ParserPool;
+
+    #[test]
+    fn dropped_parsers_should_be_reused() {
+        let pool = ParserPool::new(crate::language(), 1);
+        let (first, second) = (pool.get(), pool.get());
+        assert_eq!(pool.idle_count(), 0);
+        drop(first);
+        drop(second);
+        // The second one did not fit
+        assert_eq!(pool.idle_count(), 1);
+
+        let mut parser = pool.get();
+        assert_eq!(pool.idle_count(), 0);
+        let tree = parser.parse("■┬ src/main.rs\n └ 1: foo", None).unwrap();
+        assert_eq!(tree.root_node().named_child_count(), 1);
+    }
+
+    #[test]
+    fn reused_parser_should_not_keep_the_settings_of_its_borrower() {
+        let pool = ParserPool::new(crate::language(), 1);
+        let text = crate::document(20_000);
+        {
+            let mut parser = pool.get();
+            parser.set_timeout_micros(1);
+            // Leave an unfinished parse behind
+            assert!(parser.parse(&text, None).is_none());
+        }
+        let mut parser = pool.get();
+        assert_eq!(parser.timeout_micros(), 0);
+        let tree = parser.parse(&text, None).unwrap();
+        assert_eq!(tree.root_node().named_child_count(), 20_000);
+    }
+
+    #[test]
+    fn shared_pool_should_hand_out_quickfix_parsers() {
+        let tree = super::parser().parse("■┬ a.rs\n └ 1: b", None).unwrap();
+        assert_eq!(tree.language(), crate::language());
+    }
+}
@@ -0,0 +1,260 @@
+//! Instrumentation of quickfix parses.
+//!
+//! [`InstrumentedParser`] reports [`ParseStats`] for every parse, and adds
+//! them to process-wide [`counters`] that can be exported periodically.
+//!
+//! The byte count, the node count (`ts_node_descendant_count` is constant
+//! time) and the wall time are always measured, which is cheap enough to
+//! leave on. Counting lexer calls and reused nodes requires a tree-sitter
+//! logger, which formats a message for every lexer and parser action, so it
+//! is only done after [`InstrumentedParser::set_detailed`].
+
+use std::{
+    fmt,
+    sync::{
+        atomic::{AtomicU64, Ordering},
+        Arc,
+    },
+    time::{Duration, Instant},
+};
+
+use tree_sitter::{LogType, Parser, Tree};
+
+#[derive(Debug, Clone, Copy, PartialEq, Default)]
+pub struct ParseStats {
+    pub bytes: usize,
+    pub node_count: usize,
+    pub wall_time: Duration,
+    /// Only available in detailed mode
+    pub lexer_calls: Option<u64>,
+    /// The number of subtrees of the old tree that were reused as a whole.
+    /// Only available in detailed mode.
+    pub reused_nodes: Option<u64>,
+    /// The share of the document outside of the ranges that changed since
+    /// the old tree, for incremental parses
+    pub reuse_ratio: Option<f64>,
+}
+
+/// Totals over all instrumented parses of this process
+#[derive(Debug, Default)]
+pub struct ParseCounters {
+    parses: AtomicU64,
+    bytes: AtomicU64,
+    nodes: AtomicU64,
+    wall_time_micros: AtomicU64,
+    lexer_calls: AtomicU64,
+    reused_nodes: AtomicU64,
+}
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default)]
+pub struct CountersSnapshot {
+    pub parses: u64,
+    pub bytes: u64,
+    pub nodes: u64,
+    pub wall_time_micros: u64,
+    pub lexer_calls: u64,
+    pub reused_nodes: u64,
+}
+
+impl ParseCounters {
+    const fn new() -> Self {
+        Self {
+            parses: AtomicU64::new(0),
+            bytes: AtomicU64::new(0),
+            nodes: AtomicU64::new(0),
+            wall_time_micros: AtomicU64::new(0),
+            lexer_calls: AtomicU64::new(0),
+            reused_nodes: AtomicU64::new(0),
+        }
+    }
+
+    fn add(&self, stats: &ParseStats) {
+        self.parses.fetch_add(1, Ordering::Relaxed);
+        self.bytes.fetch_add(stats.bytes as u64, Ordering::Relaxed);
+        self.nodes
+            .fetch_add(stats.node_count as u64, Ordering::Relaxed);
+        self.wall_time_micros
+            .fetch_add(stats.wall_time.as_micros() as u64, Ordering::Relaxed);
+        self.lexer_calls
+            .fetch_add(stats.lexer_calls.unwrap_or(0), Ordering::Relaxed);
+        self.reused_nodes
+            .fetch_add(stats.reused_nodes.unwrap_or(0), Ordering::Relaxed);
+    }
+
+    pub fn snapshot(&self) -> CountersSnapshot {
+        CountersSnapshot {
+            parses: self.parses.load(Ordering::Relaxed),
+            bytes: self.bytes.load(Ordering::Relaxed),
+            nodes: self.nodes.load(Ordering::Relaxed),
+            wall_time_micros: self.wall_time_micros.load(Ordering::Relaxed),
+            lexer_calls: self.lexer_calls.load(Ordering::Relaxed),
+            reused_nodes: self.reused_nodes.load(Ordering::Relaxed),
+        }
+    }
+}
+
+/// In the Prometheus text format, one counter per line
+impl fmt::Display for CountersSnapshot {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        let counters = [
+            ("parses", self.parses),
+            ("bytes", self.bytes),
+            ("nodes", self.nodes),
+            ("wall_time_micros", self.wall_time_micros),
+            ("lexer_calls", self.lexer_calls),
+            ("reused_nodes", self.reused_nodes),
+        ];
+        for (name, value) in counters {
+            writeln!(f, "tree_sitter_quickfix_{name}_total {value}")?;
+        }
+        Ok(())
+    }
+}
+
+static COUNTERS: ParseCounters = ParseCounters::new();
+
+/// The totals of all parses done by an [`InstrumentedParser`]
+pub fn counters() -> &'static ParseCounters {
+    &COUNTERS
+}
+
+#[derive(Debug, Default)]
+struct LogCounts {
+    lexer_calls: AtomicU64,
+    reused_nodes: AtomicU64,
+}
+
+/// A parser for the quickfix language that measures every parse.
+pub struct InstrumentedParser {
+    parser: Parser,
+    /// Set in detailed mode, shared with the logger of `parser`
+    log_counts: Option<Arc<LogCounts>>,
+}
+
+impl InstrumentedParser {
+    pub fn new() -> Self {
+        let mut parser = Parser::new();
+        parser
+            .set_language(&crate::language())
+            .expect("Error loading quickfix language");
+        Self {
+            parser,
+            log_counts: None,
+        }
+    }
+
+    /// Also count lexer calls and reused nodes, at the cost of a logger call
+    /// for every lexer and parser action
+    pub fn set_detailed(&mut self, detailed: bool) {
+        if !detailed {
+            self.parser.set_logger(None);
+            self.log_counts = None;
+            return;
+        }
+        let log_counts = Arc::new(LogCounts::default());
+        let counts = log_counts.clone();
+        self.parser
+            .set_logger(Some(Box::new(move |log_type, message| {
+                // See `ts_parser__lex` and `ts_parser__reuse_node` in the
+                // tree-sitter runtime
+                if !matches!(log_type, LogType::Parse) {
+                    return;
+                }
+                if message.starts_with("lexed_lookahead") {
+                    counts.lexer_calls.fetch_add(1, Ordering::Relaxed);
+                } else if message.starts_with("reuse_node") {
+                    counts.reused_nodes.fetch_add(1, Ordering::Relaxed);
+                }
+            })));
+        self.log_counts = Some(log_counts);
+    }
+
+    /// Parse `text`, like [`Parser::parse`]
+    pub fn parse(
+        &mut self,
+        text: impl AsRef<[u8]>,
+        old_tree: Option<&Tree>,
+    ) -> Option<(Tree, ParseStats)> {
+        let text = text.as_ref();
+        if let Some(log_counts) = &self.log_counts {
+            log_counts.lexer_calls.store(0, Ordering::Relaxed);
+            log_counts.reused_nodes.store(0, Ordering::Relaxed);
+        }
+        let start = Instant::now();
+        let tree = self.parser.parse(text, old_tree)?;
+        let wall_time = start.elapsed();
+
+        let reuse_ratio = old_tree.map(|old_tree| {
+            let changed_bytes: usize = old_tree
+                .changed_ranges(&tree)
+                .map(|range| range.end_byte - range.start_byte)
+                .sum();
+            1.0 - (changed_bytes as f64 / text.len().max(1) as f64).min(1.0)
+        });
+        let stats = ParseStats {
+            bytes: text.len(),
+            node_count: tree.root_node().descendant_count(),
+            wall_time,
+            lexer_calls: self
+                .log_counts
+                .as_ref()
+                .map(|counts| counts.lexer_calls.load(Ordering::Relaxed)),
+            reused_nodes: self
+                .log_counts
+                .as_ref()
+                .map(|counts| counts.reused_nodes.load(Ordering::Relaxed)),
+            reuse_ratio,
+        };
+        COUNTERS.add(&stats);
+        Some((tree, stats))
+    }
+}
+
+impl Default for InstrumentedParser {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+#[cfg(test)]
+mod test_stats {
+    use tree_sitter::{InputEdit, Point};
+
+    use super::{counters, InstrumentedParser};
+
+    #[test]
+    fn should_report_parse_stats() {
+        let text = "■┬ a.rs\n ├ 1: foo\n └ 2: bar\n\n■┬ b.rs\n └ 3: spam";
+        let mut parser = InstrumentedParser::new();
+        let (tree, stats) = parser.parse(text, None).unwrap();
+        assert_eq!(stats.bytes, text.len());
+        assert_eq!(stats.node_count, tree.root_node().descendant_count());
+        assert!(stats.node_count > 10);
+        assert_eq!(stats.lexer_calls, None);
+        assert_eq!(stats.reuse_ratio, None);
+
+        parser.set_detailed(true);
+        let new_text = text.replace("spam", "eggs");
+        let mut old_tree = tree.clone();
+        let start_byte = text.len() - 4;
+        old_tree.edit(&InputEdit {
+            start_byte,
+            old_end_byte: text.len(),
+            new_end_byte: text.len(),
+            start_position: Point::new(5, 8),
+            old_end_position: Point::new(5, 12),
+            new_end_position: Point::new(5, 12),
+        });
+        let (_, stats) = parser.parse(&new_text, Some(&old_tree)).unwrap();
+        assert!(stats.lexer_calls.unwrap() > 0);
+        // The first section is reused
+        assert!(stats.reused_nodes.unwrap() > 0);
+        assert!(stats.reuse_ratio.unwrap() > 0.5);
+
+        let snapshot = counters().snapshot();
+        assert!(snapshot.parses >= 2);
+        assert!(snapshot
+            .to_string()
+            .contains("tree_sitter_quickfix_parses_total"));
+    }
+}
@@ -0,0 +1,444 @@
+//! Parsing only the part of a quickfix document that is on screen.
+//!
+//! A quickfix list with hundreds of thousands of entries is displayed a
+//! screen at a time, so [`ViewportTree`] only parses the sections that
+//! overlap the visible lines (plus a margin), by restricting the parser to
+//! them with included ranges. More sections are parsed as the viewport
+//! moves; the sections parsed before stay parsed, so that scrolling back is
+//! free, but the sections jumped over are only parsed once they are visible.
+
+use std::ops::Range;
+
+use tree_sitter::{Point, Tree};
+
+use crate::{BudgetedParser, LayoutError, ParseOutcome, QuickfixLayout};
+
+/// The start of the line of the marker at `marker_start`. Only spaces are
+/// skipped between tokens, so the line starts after the spaces preceding the
+/// marker.
+fn line_start(bytes: &[u8], marker_start: usize) -> usize {
+    let indentation = bytes[..marker_start]
+        .iter()
+        .rev()
+        .take_while(|byte| **byte == b' ')
+        .count();
+    marker_start - indentation
+}
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+struct SectionStart {
+    /// The start of the line of the header, including its indentation
+    byte: usize,
+    row: usize,
+}
+
+/// A tree of the sections of a quickfix document around the viewport.
+#[derive(Clone)]
+pub struct ViewportTree {
+    sections: Vec<SectionStart>,
+    len: usize,
+    end_point: Point,
+    margin: usize,
+    /// Indices of the parsed sections, as ordered runs that neither overlap
+    /// nor touch
+    parsed: Vec<Range<usize>>,
+    /// Indices of the sections of a parse that ran out of budget, see
+    /// [`ViewportTree::ensure_visible_within`]
+    pending: Option<Vec<Range<usize>>>,
+    tree: Option<Tree>,
+}
+
+/// The result of [`ViewportTree::ensure_visible_within`]
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum ViewportProgress {
+    /// The wanted sections were parsed already
+    Unchanged,
+    /// The tree now covers the wanted sections
+    Changed,
+    /// The budget was spent before the wanted sections were parsed, see
+    /// [`ViewportTree::resume`]
+    Pending,
+}
+
+impl ViewportTree {
+    /// Find the section boundaries of `text` without parsing it. Sections
+    /// within `margin` lines of the viewport are parsed too.
+    pub fn new(text: &str, margin: usize) -> Self {
+        // Markers are only recognized at the start of a line, after the
+        // indentation, so a header is a line that starts with `■┬`
+        let mut sections = Vec::new();
+        let mut byte = 0;
+        for (row, line) in text.split('\n').enumerate() {
+            if line.trim_start_matches(' ').starts_with("■┬") {
+                sections.push(SectionStart { byte, row });
+            }
+            byte += line.len() + 1;
+        }
+        Self::with_sections(text.as_bytes(), sections, margin)
+    }
+
+    /// Like [`ViewportTree::new`], but the section boundaries are taken from
+    /// `layout` instead of scanning `text`.
+    pub fn from_layout(
+        text: &str,
+        layout: &QuickfixLayout,
+        margin: usize,
+    ) -> Result<Self, LayoutError> {
+        layout.validate(text)?;
+        let bytes = text.as_bytes();
+        let sections = layout
+            .headers()
+            .map(|(row, marker_start)| SectionStart {
+                byte: line_start(bytes, marker_start),
+                row,
+            })
+            .collect();
+        Ok(Self::with_sections(bytes, sections, margin))
+    }
+
+    fn with_sections(bytes: &[u8], mut sections: Vec<SectionStart>, margin: usize) -> Self {
+        let last = sections
+            .last()
+            .copied()
+            .unwrap_or(SectionStart { byte: 0, row: 0 });
+        // Anything before the first header belongs to the first section, so
+        // that a fully parsed document covers the whole text
+        if let Some(first) = sections.first_mut() {
+            *first = SectionStart { byte: 0, row: 0 }
+        }
+        let row = last.row
+            + bytes[last.byte..]
+                .iter()
+                .filter(|byte| **byte == b'\n')
+                .count();
+        let last_line_start = bytes
+            .iter()
+            .rposition(|byte| *byte == b'\n')
+            .map_or(0, |newline| newline + 1);
+        Self {
+            sections,
+            len: bytes.len(),
+            end_point: Point::new(row, bytes.len() - last_line_start),
+            margin,
+            parsed: Vec::new(),
+            pending: None,
+            tree: None,
+        }
+    }
+
+    /// Make sure that the sections overlapping `rows` are parsed, reading the
+    /// document through `input` (see [`tree_sitter::Parser::parse_with`])
+    /// with a parser of the shared [pool](crate::parser).
+    ///
+    /// Returns whether the tree changed.
+    pub fn ensure_visible<T: AsRef<[u8]>, F: FnMut(usize, Point) -> T>(
+        &mut self,
+        rows: Range<usize>,
+        input: &mut F,
+    ) -> bool {
+        let Some(wanted) = self.wanted_sections(rows) else {
+            return false;
+        };
+        let mut parser = crate::parser();
+        parser
+            .set_included_ranges(&self.included_ranges(&wanted))
+            .expect("Section ranges are ordered");
+        // The old tree is reused for the sections that were already parsed
+        let Some(tree) = parser.parse_with(input, self.tree.as_ref()) else {
+            return false;
+        };
+        self.tree = Some(tree);
+        self.parsed = wanted;
+        self.pending = None;
+        true
+    }
+
+    /// Like [`ViewportTree::ensure_visible`], but spend at most the budget of
+    /// `parser`. A parse that ran out of budget is continued by the next call
+    /// whose sections it covers, or by [`ViewportTree::resume`], and abandoned
+    /// by a call that wants other sections.
+    ///
+    /// `parser` must not be pending with the parse of another document.
+    pub fn ensure_visible_within<T: AsRef<[u8]>, F: FnMut(usize, Point) -> T>(
+        &mut self,
+        rows: Range<usize>,
+        parser: &mut BudgetedParser,
+        input: &mut F,
+    ) -> ViewportProgress {
+        let Some(visible) = self.visible_sections(rows) else {
+            return ViewportProgress::Unchanged;
+        };
+        if covers(&self.parsed, &visible) {
+            return ViewportProgress::Unchanged;
+        }
+        match self.pending.clone() {
+            // The pending parse covers the visible sections as well
+            Some(pending) if parser.is_pending() && covers(&pending, &visible) => {
+                self.parse_within(pending, parser, input)
+            }
+            _ => {
+                let wanted = self.with_parsed(visible);
+                parser.set_included_ranges(&self.included_ranges(&wanted));
+                self.parse_within(wanted, parser, input)
+            }
+        }
+    }
+
+    /// Continue the parse that ran out of budget, if any
+    pub fn resume<T: AsRef<[u8]>, F: FnMut(usize, Point) -> T>(
+        &mut self,
+        parser: &mut BudgetedParser,
+        input: &mut F,
+    ) -> ViewportProgress {
+        match self.pending.clone() {
+            Some(wanted) if parser.is_pending() => self.parse_within(wanted, parser, input),
+            _ => {
+                self.pending = None;
+                ViewportProgress::Unchanged
+            }
+        }
+    }
+
+    /// Whether a parse ran out of budget, see [`ViewportTree::resume`]
+    pub fn is_pending(&self) -> bool {
+        self.pending.is_some()
+    }
+
+    /// Forget the parse that ran out of budget, e.g. because the parser was
+    /// reset or given another document. The next call parses from scratch.
+    pub fn abandon(&mut self) {
+        self.pending = None;
+    }
+
+    fn parse_within<T: AsRef<[u8]>, F: FnMut(usize, Point) -> T>(
+        &mut self,
+        wanted: Vec<Range<usize>>,
+        parser: &mut BudgetedParser,
+        input: &mut F,
+    ) -> ViewportProgress {
+        match parser.parse_with(input, self.tree.as_ref()) {
+            ParseOutcome::Done(tree) => {
+                self.tree = Some(tree);
+                self.parsed = wanted;
+                self.pending = None;
+                ViewportProgress::Changed
+            }
+            ParseOutcome::Pending => {
+                self.pending = Some(wanted);
+                ViewportProgress::Pending
+            }
+            ParseOutcome::Cancelled => {
+                self.pending = None;
+                ViewportProgress::Unchanged
+            }
+        }
+    }
+
+    /// The sections to parse so that the ones overlapping `rows` are parsed,
+    /// or `None` if they are parsed already
+    fn wanted_sections(&self, rows: Range<usize>) -> Option<Vec<Range<usize>>> {
+        let visible = self.visible_sections(rows)?;
+        (!covers(&self.parsed, &visible)).then(|| self.with_parsed(visible))
+    }
+
+    /// The sections within the margin of `rows`, or `None` if there are no
+    /// sections
+    fn visible_sections(&self, rows: Range<usize>) -> Option<Range<usize>> {
+        if self.sections.is_empty() {
+            return None;
+        }
+        let start_row = rows.start.saturating_sub(self.margin);
+        let end_row = rows.end.saturating_add(self.margin);
+        // The section containing `start_row`, up to the last section starting
+        // before `end_row`
+        let first = self
+            .sections
+            .partition_point(|section| section.row <= start_row)
+            .saturating_sub(1);
+        let last = self
+            .sections
+            .partition_point(|section| section.row < end_row)
+            .max(first + 1);
+        Some(first..last)
+    }
+
+    /// The parsed sections and `sections`, merging the runs that overlap or
+    /// touch. The sections in between are left out, so that jumping through a
+    /// document does not parse everything that was jumped over.
+    fn with_parsed(&self, sections: Range<usize>) -> Vec<Range<usize>> {
+        let mut runs = self.parsed.clone();
+        let at = runs.partition_point(|run| run.start < sections.start);
+        runs.insert(at, sections);
+        let mut merged: Vec<Range<usize>> = Vec::with_capacity(runs.len());
+        for run in runs {
+            match merged.last_mut() {
+                Some(last) if run.start <= last.end => last.end = last.end.max(run.end),
+                _ => merged.push(run),
+            }
+        }
+        merged
+    }
+
+    fn included_ranges(&self, runs: &[Range<usize>]) -> Vec<tree_sitter::Range> {
+        runs.iter()
+            .map(|sections| {
+                let start = self.sections[sections.start];
+                let (end_byte, end_point) = match self.sections.get(sections.end) {
+                    Some(end) => (end.byte, Point::new(end.row, 0)),
+                    None => (self.len, self.end_point),
+                };
+                tree_sitter::Range {
+                    start_byte: start.byte,
+                    end_byte,
+                    start_point: Point::new(start.row, 0),
+                    end_point,
+                }
+            })
+            .collect()
+    }
+
+    pub fn tree(&self) -> Option<&Tree> {
+        self.tree.as_ref()
+    }
+
+    /// The rows covered by the parsed sections, in order
+    pub fn parsed_rows(&self) -> Vec<Range<usize>> {
+        self.parsed
+            .iter()
+            .map(|parsed| {
+                let start = self.sections[parsed.start].row;
+                let end = self
+                    .sections
+                    .get(parsed.end)
+                    .map_or(self.end_point.row + 1, |section| section.row);
+                start..end
+            })
+            .collect()
+    }
+
+    /// The rows of the sections overlapping `rows`, parsed or not, e.g. to
+    /// widen a change of the text to the sections it touches like
+    /// [`changed_sections`](crate::changed_sections) does for trees
+    pub fn section_rows(&self, rows: Range<usize>) -> Range<usize> {
+        if self.sections.is_empty() {
+            return rows;
+        }
+        let first = self
+            .sections
+            .partition_point(|section| section.row <= rows.start)
+            .saturating_sub(1);
+        let last = self
+            .sections
+            .partition_point(|section| section.row < rows.end)
+            .max(first + 1);
+        let end = self
+            .sections
+            .get(last)
+            .map_or(self.end_point.row + 1, |section| section.row);
+        self.sections[first].row..end.max(rows.end)
+    }
+
+    /// Whether every section of the document is parsed
+    pub fn is_complete(&self) -> bool {
+        self.sections.is_empty() || self.parsed == [0..self.sections.len()]
+    }
+}
+
+/// Whether one of `runs` contains all of `sections`
+fn covers(runs: &[Range<usize>], sections: &Range<usize>) -> bool {
+    runs.iter()
+        .any(|run| run.start <= sections.start && sections.end <= run.end)
+}
+
+#[cfg(test)]
+mod test_viewport {
+    use tree_sitter::Point;
+
+    use super::{ViewportProgress, ViewportTree};
+    use crate::{document, BudgetedParser};
+
+    #[test]
+    fn should_widen_rows_to_their_sections() {
+        let viewport = ViewportTree::new(&document(100), 2);
+        assert_eq!(viewport.section_rows(41..42), 40..44);
+        assert_eq!(viewport.section_rows(43..46), 40..48);
+        assert_eq!(viewport.section_rows(397..398), 396..399);
+        assert_eq!(ViewportTree::new("", 2).section_rows(0..1), 0..1);
+    }
+
+    #[test]
+    fn should_parse_sections_around_viewport() {
+        // Every section spans 4 rows, including the blank line
+        let text = document(100);
+        let bytes = text.as_bytes();
+        let mut input = |byte: usize, _: Point| bytes.get(byte..).unwrap_or_default();
+        let mut viewport = ViewportTree::new(&text, 2);
+
+        assert!(viewport.ensure_visible(40..50, &mut input));
+        assert_eq!(viewport.parsed_rows(), [36..52]);
+        let root = viewport.tree().unwrap().root_node();
+        assert!(!root.has_error());
+        assert_eq!(root.named_child_count(), 4);
+        let header = root.named_child(0).unwrap().child(0).unwrap();
+        assert_eq!(header.start_position().row, 36);
+        assert_eq!(header.utf8_text(bytes).unwrap(), "■┬ file_9.rs");
+
+        // Scrolling within the parsed range does not parse again
+        assert!(!viewport.ensure_visible(42..48, &mut input));
+
+        // Jumping further parses the new sections, but not the ones in between
+        assert!(viewport.ensure_visible(62..70, &mut input));
+        assert_eq!(viewport.parsed_rows(), [36..52, 60..72]);
+        let root = viewport.tree().unwrap().root_node();
+        assert!(!root.has_error());
+        assert_eq!(root.named_child_count(), 7);
+        assert!(!viewport.ensure_visible(40..50, &mut input));
+        assert!(!viewport.is_complete());
+
+        // Scrolling into the gap joins the parsed sections
+        assert!(viewport.ensure_visible(52..58, &mut input));
+        assert_eq!(viewport.parsed_rows(), [36..72]);
+        assert_eq!(viewport.tree().unwrap().root_node().named_child_count(), 9);
+
+        assert!(viewport.ensure_visible(0..400, &mut input));
+        assert!(viewport.is_complete());
+        let root = viewport.tree().unwrap().root_node();
+        assert_eq!(root.named_child_count(), 100);
+        assert_eq!(root.byte_range(), 0..text.len());
+    }
+
+    #[test]
+    fn should_resume_parse_across_calls() {
+        let text = document(20_000);
+        let bytes = text.as_bytes();
+        let mut input = |byte: usize, _: Point| bytes.get(byte..).unwrap_or_default();
+        let mut parser = BudgetedParser::new(
+            &crate::language(),
+            Some(std::time::Duration::from_micros(1)),
+        );
+        let mut viewport = ViewportTree::new(&text, 0);
+
+        let rows = 0..80_000;
+        assert_eq!(
+            viewport.ensure_visible_within(rows.clone(), &mut parser, &mut input),
+            ViewportProgress::Pending
+        );
+        assert!(viewport.is_pending());
+        assert!(viewport.tree().is_none());
+        // Scrolling within the pending sections keeps the pending parse
+        assert_eq!(
+            viewport.ensure_visible_within(10..20, &mut parser, &mut input),
+            ViewportProgress::Pending
+        );
+        while viewport.resume(&mut parser, &mut input) == ViewportProgress::Pending {}
+        assert!(!viewport.is_pending());
+        assert!(viewport.is_complete());
+        let root = viewport.tree().unwrap().root_node();
+        assert!(!root.has_error());
+        assert_eq!(root.named_child_count(), 20_000);
+        assert_eq!(
+            viewport.ensure_visible_within(rows, &mut parser, &mut input),
+            ViewportProgress::Unchanged
+        );
+    }
+}
@@ -0,0 +1,59 @@
+// Loader for the WebAssembly build of the grammar (`just build-wasm`), for
+// browsers and Web Workers, where the native addon in `bindings/node` cannot
+// be loaded.
+//
+// The runtime is web-tree-sitter's `Parser`, which is passed in rather than
+// required, so that pages can load it however they load their other scripts.
+// Outside of CommonJS, e.g. after `importScripts` in a worker, the loader is
+// available as `self.TreeSitterQuickfix`.
+(function (root, factory) {
+  if (typeof module === "object" && module.exports) {
+    module.exports = factory();
+  } else {
+    root.TreeSitterQuickfix = factory();
+  }
+})(typeof self !== "undefined" ? self : this, function () {
+  const WASM_FILE = "tree-sitter-quickfix.wasm";
+
+  // `load(Parser, wasm)`: initialize web-tree-sitter and load the grammar
+  // from `wasm`, a URL, a path or the bytes of the module. Under Node, `wasm`
+  // defaults to the module built next to `grammar.js`.
+  async function load(Parser, wasm) {
+    await Parser.init();
+    if (wasm === undefined) {
+      if (typeof require !== "function") {
+        throw new Error(`The location of ${WASM_FILE} is required outside of Node`);
+      }
+      wasm = require("path").join(__dirname, "..", "..", WASM_FILE);
+    }
+    return Parser.Language.load(wasm);
+  }
+
+  // `outline(tree)`: the start row, range and value count of every section,
+  // like `SectionOutline` in the Rust bindings. Trees cannot leave the worker
+  // they were parsed in, but an outline can be posted to the page.
+  //
+  // Indices are in UTF-16 code units when the tree was parsed from a JS
+  // string, which is how web-tree-sitter reads strings.
+  function outline(tree) {
+    const sections = [];
+    for (const section of tree.rootNode.namedChildren) {
+      const values = section.type === "section" && section.childForFieldName("values");
+      if (!values) continue;
+      sections.push({
+        startRow: section.startPosition.row,
+        startIndex: section.startIndex,
+        endIndex: section.endIndex,
+        valueCount: values.namedChildCount,
+      });
+    }
+    return sections;
+  }
+
+  let nodeTypeInfo;
+  try {
+    nodeTypeInfo = require("../../src/node-types.json");
+  } catch (_) {}
+
+  return { WASM_FILE, load, outline, nodeTypeInfo };
+});
@@ -0,0 +1,51 @@
+// A Web Worker that parses quickfix lists off the main thread.
+//
+// Start it with `new Worker(".../bindings/wasm/worker.js")` and post
+//
+//   { type: "init", runtime, loader, wasm }
+//
+// once, with the URLs of web-tree-sitter's `tree-sitter.js`, of
+// `bindings/wasm/index.js` and of `tree-sitter-quickfix.wasm`. Every
+// following `{ id, text }` is answered with `{ id, sections, hasError, ms }`,
+// where `sections` is the outline of `text`, see `outline` in `index.js`, and
+// `ms` is how long parsing took. Failures are answered with `{ id, error }`.
+
+let ready;
+
+async function initialize({ runtime, loader, wasm }) {
+  importScripts(runtime, loader);
+  const language = await self.TreeSitterQuickfix.load(self.TreeSitter, wasm);
+  const parser = new self.TreeSitter();
+  parser.setLanguage(language);
+  return parser;
+}
+
+function parse(parser, id, text) {
+  const start = performance.now();
+  const tree = parser.parse(text);
+  const ms = performance.now() - start;
+  try {
+    return {
+      id,
+      sections: self.TreeSitterQuickfix.outline(tree),
+      hasError: tree.rootNode.hasError(),
+      ms,
+    };
+  } finally {
+    // Trees live in the memory of the module, which is not garbage collected
+    tree.delete();
+  }
+}
+
+self.onmessage = async ({ data }) => {
+  if (data.type === "init") {
+    ready = initialize(data);
+    return;
+  }
+  try {
+    if (!ready) throw new Error("The worker has not been initialized");
+    self.postMessage(parse(await ready, data.id, data.text));
+  } catch (error) {
+    self.postMessage({ id: data.id, error: String(error) });
+  }
+};
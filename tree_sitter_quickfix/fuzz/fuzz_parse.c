@@ -0,0 +1,177 @@
+// Fuzz target for the quickfix grammar that fails on slow parses.
+//
+// Error recovery can go superlinear on malformed input, so besides crashes
+// this target aborts whenever parsing an input takes longer than a budget
+// that is linear in its size, which makes libFuzzer save the input. The
+// custom mutator works on markers and lines, which reaches the interesting
+// states (stray `├`/`└` inside words, sections without `lastValue`, ...)
+// much faster than byte-level mutations alone.
+//
+// The seeds in `fuzz/seeds` are a few lines each, one per malformed shape.
+// Superlinear recovery only shows on large inputs, so the shapes are grown
+// here rather than checked in: the mutator repeats the input, and
+// `just fuzz-regress` parses every seed both as is and repeated to
+// `QUICKFIX_FUZZ_REPEAT_BYTES` (1 MiB by default). Only minimized
+// reproductions of actual findings belong next to the seeds.
+//
+// Build and run with `just fuzz`. The budget can be tuned with the
+// `QUICKFIX_FUZZ_BASE_MS` and `QUICKFIX_FUZZ_NS_PER_BYTE` environment
+// variables, e.g. when running under sanitizers.
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <tree_sitter/api.h>
+
+const TSLanguage *tree_sitter_quickfix(void);
+
+static double base_ms = 10;
+static double ns_per_byte = 1000;
+
+static void read_budget(void) {
+  static int initialized = 0;
+  if (initialized) return;
+  initialized = 1;
+  const char *base = getenv("QUICKFIX_FUZZ_BASE_MS");
+  const char *per_byte = getenv("QUICKFIX_FUZZ_NS_PER_BYTE");
+  if (base) base_ms = atof(base);
+  if (per_byte) ns_per_byte = atof(per_byte);
+}
+
+static double now_ns(void) {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (double)time.tv_sec * 1e9 + (double)time.tv_nsec;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  static TSParser *parser;
+  read_budget();
+  if (!parser) {
+    parser = ts_parser_new();
+    ts_parser_set_language(parser, tree_sitter_quickfix());
+  }
+
+  double start = now_ns();
+  TSTree *tree = ts_parser_parse_string(parser, NULL, (const char *)data, (uint32_t)size);
+  double elapsed = now_ns() - start;
+  ts_tree_delete(tree);
+
+  double budget = base_ms * 1e6 + ns_per_byte * (double)size;
+  if (elapsed > budget) {
+    fprintf(stderr, "Parsing %zu bytes took %.1f ms, the budget is %.1f ms\n", size,
+            elapsed / 1e6, budget / 1e6);
+    abort();
+  }
+  return 0;
+}
+
+#ifdef QUICKFIX_FUZZ_STANDALONE
+
+// Run the target over the given files, without libFuzzer, and over each file
+// repeated until it is large
+int main(int argc, char **argv) {
+  const char *repeat = getenv("QUICKFIX_FUZZ_REPEAT_BYTES");
+  size_t repeat_bytes = repeat ? (size_t)atol(repeat) : 1 << 20;
+  for (int i = 1; i < argc; i++) {
+    FILE *file = fopen(argv[i], "rb");
+    if (!file) {
+      perror(argv[i]);
+      return 1;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t *data = malloc(size > 0 ? (size_t)size : 1);
+    size_t length = fread(data, 1, (size_t)size, file);
+    fclose(file);
+    printf("%s: %zu bytes\n", argv[i], length);
+    LLVMFuzzerTestOneInput(data, length);
+
+    if (length > 0 && length < repeat_bytes) {
+      size_t copies = (repeat_bytes + length - 1) / length;
+      uint8_t *repeated = malloc(copies * length);
+      for (size_t copy = 0; copy < copies; copy++) {
+        memcpy(repeated + copy * length, data, length);
+      }
+      printf("%s: repeated to %zu bytes\n", argv[i], copies * length);
+      LLVMFuzzerTestOneInput(repeated, copies * length);
+      free(repeated);
+    }
+    free(data);
+  }
+  return 0;
+}
+
+#else
+
+size_t LLVMFuzzerMutate(uint8_t *data, size_t size, size_t max_size);
+
+static const char *const FRAGMENTS[] = {"■┬", "├", "└", "\n", " ", "■", "┬", "\n\n"};
+
+// The byte offset of the start of a random line
+static size_t random_line_start(const uint8_t *data, size_t size, unsigned *seed) {
+  size_t offset = size ? (size_t)rand_r(seed) % size : 0;
+  while (offset > 0 && data[offset - 1] != '\n') offset--;
+  return offset;
+}
+
+static size_t line_end(const uint8_t *data, size_t size, size_t start) {
+  const uint8_t *newline = memchr(data + start, '\n', size - start);
+  return newline ? (size_t)(newline - data) + 1 : size;
+}
+
+size_t LLVMFuzzerCustomMutator(uint8_t *data, size_t size, size_t max_size, unsigned seed) {
+  switch (rand_r(&seed) % 5) {
+    // Insert a marker or separator anywhere, including inside a word
+    case 0: {
+      const char *fragment = FRAGMENTS[rand_r(&seed) % (sizeof(FRAGMENTS) / sizeof(FRAGMENTS[0]))];
+      size_t length = strlen(fragment);
+      if (size + length > max_size) break;
+      size_t offset = size ? (size_t)rand_r(&seed) % (size + 1) : 0;
+      memmove(data + offset + length, data + offset, size - offset);
+      memcpy(data + offset, fragment, length);
+      return size + length;
+    }
+    // Delete a line, e.g. the `lastValue` of a section
+    case 1: {
+      if (size == 0) break;
+      size_t start = random_line_start(data, size, &seed);
+      size_t end = line_end(data, size, start);
+      memmove(data + start, data + end, size - end);
+      return size - (end - start);
+    }
+    // Duplicate a line, e.g. to build long runs of values or headers
+    case 2: {
+      if (size == 0) break;
+      size_t start = random_line_start(data, size, &seed);
+      size_t end = line_end(data, size, start);
+      size_t length = end - start;
+      if (size + length > max_size) break;
+      memmove(data + end + length, data + end, size - end);
+      memcpy(data + end, data + start, length);
+      return size + length;
+    }
+    // Repeat the whole input, which grows a seed to the sizes where
+    // superlinear recovery shows within a few mutations
+    case 3: {
+      if (size == 0) break;
+      size_t copies = max_size / size;
+      if (copies < 2) break;
+      if (copies > 8) copies = 8;
+      for (size_t copy = 1; copy < copies; copy++) {
+        memcpy(data + copy * size, data, size);
+      }
+      return copies * size;
+    }
+    default:
+      break;
+  }
+  return LLVMFuzzerMutate(data, size, max_size);
+}
+
+#endif
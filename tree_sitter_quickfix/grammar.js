@@ -1,12 +1,3 @@
-const makeQuote = (quote) => ($) =>
-  choice(
-    prec.left(seq(quote, quote)),
-    prec.left(seq(quote, $.expressions, quote))
-  );
-
-const makeEnclose = (open, close) => ($) =>
-  choice(seq(open, close), seq(open, $.expressions, close));
-
 module.exports = grammar({
   name: "quickfix",
 
@@ -29,7 +20,11 @@ module.exports = grammar({
 
     lastValue: ($) => seq("└", $.word),
 
-    // A word is a sequence of non-whitespace characters
+    // A word is the rest of the line. Markers are only recognized at the
+    // start of a line, so match text that contains `■┬`, `├` or `└` needs no
+    // quoting. Line breaks are the one thing a word cannot contain; the editor
+    // escapes them before rendering, see `escape_line_breaks` in
+    // `src/components/dropdown.rs`.
     word: ($) => /[^\n]+/,
   },
 });
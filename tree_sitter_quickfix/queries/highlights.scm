@@ -0,0 +1,14 @@
+; The "■┬" of a header and the "├"/"└" of a value are anonymous nodes, so
+; they can be matched by their text
+
+(header
+  "■┬" @punctuation.special
+  (word) @string.special.path)
+
+(value
+  "├" @punctuation.delimiter
+  (word) @string)
+
+(lastValue
+  "└" @punctuation.delimiter
+  (word) @string)
@@ -0,0 +1,145 @@
+#!/usr/bin/env node
+// Checks that the generated files in `src/` match `grammar.js`.
+//
+// `src/parser.c`, `src/grammar.json` and `src/node-types.json` are generated
+// by `tree-sitter generate` (see the `build` script in `package.json`) and
+// committed, so that the crates and the Node binding build without the CLI.
+// Editing them by hand, or `grammar.js` without regenerating, makes them
+// disagree in ways that only show up as odd trees. This script
+//
+// - evaluates `grammar.js` with the subset of the grammar DSL it uses, and
+//   compares the result with `src/grammar.json`,
+// - checks that the fields of every rule are the ones of `node-types.json`,
+// - checks that the symbols, fields and external tokens of `src/parser.c` are
+//   the ones of the grammar.
+//
+// Usage: node script/check-generated.js
+
+"use strict";
+
+const assert = require("assert");
+const fs = require("fs");
+const path = require("path");
+
+const root = path.join(__dirname, "..");
+const read = (file) => fs.readFileSync(path.join(root, file), "utf8");
+
+// The rules are normalized the way the CLI writes them to `grammar.json`
+function normalize(rule) {
+  if (typeof rule === "string") return { type: "STRING", value: rule };
+  if (rule instanceof RegExp) return { type: "PATTERN", value: rule.source };
+  return rule;
+}
+
+const dsl = {
+  seq: (...members) => ({ type: "SEQ", members: members.map(normalize) }),
+  choice: (...members) => ({ type: "CHOICE", members: members.map(normalize) }),
+  repeat: (content) => ({ type: "REPEAT", content: normalize(content) }),
+  repeat1: (content) => ({ type: "REPEAT1", content: normalize(content) }),
+  field: (name, content) => ({ type: "FIELD", name, content: normalize(content) }),
+  grammar(options) {
+    const $ = new Proxy({}, { get: (_, name) => ({ type: "SYMBOL", name }) });
+    const rules = {};
+    for (const [name, rule] of Object.entries(options.rules)) {
+      rules[name] = normalize(rule($));
+    }
+    const list = (key) => (options[key] ? options[key]($).map(normalize) : []);
+    return {
+      name: options.name,
+      rules,
+      extras: list("extras"),
+      conflicts: list("conflicts"),
+      precedences: list("precedences"),
+      externals: list("externals"),
+      inline: list("inline"),
+      supertypes: list("supertypes"),
+    };
+  },
+};
+
+function evaluateGrammar() {
+  const module = { exports: {} };
+  const source = read("grammar.js");
+  const evaluate = new Function("module", "exports", ...Object.keys(dsl), source);
+  evaluate(module, module.exports, ...Object.values(dsl));
+  return module.exports;
+}
+
+// The names of the fields used anywhere in `rule`
+function fieldNames(rule, names = new Set()) {
+  if (rule.type === "FIELD") names.add(rule.name);
+  for (const child of rule.members || (rule.content ? [rule.content] : [])) {
+    fieldNames(child, names);
+  }
+  return names;
+}
+
+// The string literals of a C array such as `ts_symbol_names`
+function cArray(source, name) {
+  const begin = source.indexOf(`${name}[`);
+  if (begin < 0) throw new Error(`${name} not found in src/parser.c`);
+  const end = source.indexOf("\n};\n", begin);
+  return source.slice(begin, end);
+}
+
+function define(source, name) {
+  const match = source.match(new RegExp(`#define ${name} (\\d+)`));
+  if (!match) throw new Error(`${name} not defined in src/parser.c`);
+  return Number(match[1]);
+}
+
+const grammar = evaluateGrammar();
+const grammarJson = JSON.parse(read("src/grammar.json"));
+assert.deepStrictEqual(grammarJson, grammar, "src/grammar.json does not match grammar.js");
+
+const nodeTypes = JSON.parse(read("src/node-types.json"));
+for (const [name, rule] of Object.entries(grammar.rules)) {
+  const nodeType = nodeTypes.find((type) => type.type === name && type.named);
+  assert(nodeType, `${name} is missing from src/node-types.json`);
+  assert.deepStrictEqual(
+    Object.keys(nodeType.fields || {}).sort(),
+    [...fieldNames(rule)].sort(),
+    `the fields of ${name} in src/node-types.json do not match grammar.js`,
+  );
+}
+
+const parser = read("src/parser.c");
+const symbolNames = cArray(parser, "ts_symbol_names");
+for (const name of Object.keys(grammar.rules)) {
+  assert(symbolNames.includes(`] = "${name}"`), `${name} is not a symbol of src/parser.c`);
+}
+
+const fields = [...new Set(Object.values(grammar.rules).flatMap((rule) => [...fieldNames(rule)]))];
+assert.strictEqual(define(parser, "FIELD_COUNT"), fields.length, "FIELD_COUNT of src/parser.c");
+if (fields.length > 0) {
+  const fieldArray = cArray(parser, "ts_field_names");
+  // The CLI numbers the fields in alphabetical order, starting at 1
+  fields.sort().forEach((name, index) => {
+    assert(parser.includes(`field_${name} = ${index + 1},`), `field ${name} of src/parser.c`);
+    assert(fieldArray.includes(`[field_${name}] = "${name}"`), `field ${name} of src/parser.c`);
+  });
+}
+
+const externals = grammar.externals.map((external) => external.name);
+assert.strictEqual(
+  define(parser, "EXTERNAL_TOKEN_COUNT"),
+  externals.length,
+  "EXTERNAL_TOKEN_COUNT of src/parser.c",
+);
+if (externals.length > 0) {
+  const symbolMap = cArray(parser, "ts_external_scanner_symbol_map");
+  externals.forEach((name, index) => {
+    assert(parser.includes(`ts_external_token_${name} = ${index},`), `external ${name} of src/parser.c`);
+    assert(
+      symbolMap.includes(`[ts_external_token_${name}] = sym_${name},`),
+      `external ${name} of src/parser.c`,
+    );
+  });
+  // Error recovery lets the scanner try every external token
+  assert(
+    cArray(parser, "ts_lex_modes").includes("[0] = {.lex_state = 0, .external_lex_state = 1},"),
+    "the error state of src/parser.c does not call the external scanner",
+  );
+}
+
+console.log("src/ matches grammar.js");
@@ -0,0 +1,440 @@
+#!/usr/bin/env node
+// Post-generation optimization of the parse table in `src/parser.c`.
+//
+// All states but the first `LARGE_STATE_COUNT` ones live in
+// `ts_small_parse_table`, where `ts_language_lookup` follows
+// `ts_small_parse_table_map` to the entry of the state and then scans its
+// groups (`ACTIONS(n), count, symbols...`) linearly until it finds the
+// symbol. The generator lays out states and groups in the order it created
+// them, which puts the states of the `├ word \n` loop in the middle of the
+// table and their hot symbols behind cold ones.
+//
+// This script counts the lookups of every (state, symbol) pair while running
+// the shift/reduce loop of the tables over the benchmark documents (the same
+// shapes as `benches/corpus/mod.rs`) and the documents of `corpus/`, then
+//
+// - renumbers the small states by descending lookup count, so that the hot
+//   states are adjacent at the start of `ts_small_parse_table`, and
+// - orders the groups of each small state, and the symbols within a group,
+//   by descending lookup count, so that the scan stops early.
+//
+// Large states, and thus the error state 0 and the start state 1, keep their
+// numbers. The rewritten tables are checked to be equivalent to the original
+// ones (modulo the renumbering) before `src/parser.c` is overwritten.
+//
+// Usage: node script/optimize-parse-table.js [src/parser.c] [--check]
+//
+// With `--check`, nothing is written and the exit status tells whether the
+// file is already optimized. Run after `tree-sitter generate`, see the
+// `build` script in `package.json`.
+
+"use strict";
+
+const fs = require("fs");
+const path = require("path");
+
+const root = path.join(__dirname, "..");
+const args = process.argv.slice(2);
+const checkOnly = args.includes("--check");
+const file = args.find((arg) => !arg.startsWith("--")) || path.join(root, "src", "parser.c");
+
+const MARKER = "// Parse table optimized by script/optimize-parse-table.js\n";
+// `ts_small_parse_table` is an array of uint16_t
+const CACHE_LINE_ENTRIES = 64 / 2;
+
+function block(source, start) {
+  const begin = source.indexOf(start);
+  if (begin < 0) throw new Error(`${start} not found`);
+  const end = source.indexOf("\n};\n", begin) + "\n};\n".length;
+  return { begin, end, text: source.slice(begin, end) };
+}
+
+function define(source, name) {
+  const match = source.match(new RegExp(`#define ${name} (\\d+)`));
+  if (!match) throw new Error(`${name} not defined`);
+  return Number(match[1]);
+}
+
+function parse(source) {
+  const language = {
+    stateCount: define(source, "STATE_COUNT"),
+    largeStateCount: define(source, "LARGE_STATE_COUNT"),
+  };
+
+  // Symbol ids and the text of anonymous tokens
+  language.symbols = { ts_builtin_sym_end: 0 };
+  const symbolEnum = source.slice(source.indexOf("enum {"), source.indexOf("};", source.indexOf("enum {")));
+  for (const [, name, id] of symbolEnum.matchAll(/(\w+) = (\d+),/g)) {
+    language.symbols[name] = Number(id);
+  }
+  language.names = {};
+  const names = block(source, "static const char * const ts_symbol_names[]").text;
+  for (const [, symbol, name] of names.matchAll(/\[(\w+)\] = "((?:[^"\\]|\\.)*)",/g)) {
+    language.names[symbol] = JSON.parse(`"${name}"`);
+  }
+
+  language.large = [];
+  const large = block(source, "static const uint16_t ts_parse_table[");
+  for (const [, state, body] of large.text.matchAll(/\n  \[(\d+)\] = \{\n([\s\S]*?)\n  \},/g)) {
+    language.large[Number(state)] = [...body.matchAll(/\[(\w+)\] = (ACTIONS|STATE)\((\d+)\),/g)].map(
+      ([, symbol, kind, value]) => ({ symbol, kind, value: Number(value) })
+    );
+  }
+
+  // Small states, in the order of `ts_small_parse_table_map`
+  const map = block(source, "static const uint32_t ts_small_parse_table_map[]").text;
+  const offsets = new Map(
+    [...map.matchAll(/\[SMALL_STATE\((\d+)\)\] = (\d+),/g)].map(([, state, offset]) => [Number(offset), Number(state)])
+  );
+  const small = block(source, "static const uint16_t ts_small_parse_table[]").text;
+  const words = small
+    .slice(small.indexOf("{") + 1, small.lastIndexOf("}"))
+    .split(",")
+    .map((word) => word.trim())
+    .filter((word) => word);
+  language.small = [];
+  for (let i = 0, offset = 0; i < words.length; ) {
+    const [, index, groupCount] = words[i++].match(/^\[(\d+)\] = (\d+)$/);
+    if (Number(index) !== offset) throw new Error(`unexpected offset ${index}`);
+    const state = offsets.get(offset);
+    const groups = [];
+    offset += 1;
+    for (let group = 0; group < Number(groupCount); group++) {
+      const [, kind, value] = words[i++].match(/^(ACTIONS|STATE)\((\d+)\)$/);
+      const count = Number(words[i++]);
+      groups.push({ kind, value: Number(value), symbols: words.slice(i, i + count) });
+      i += count;
+      offset += 2 + count;
+    }
+    language.small[state] = groups;
+  }
+
+  language.actions = [];
+  const actions = block(source, "static const TSParseActionEntry ts_parse_actions[]").text;
+  for (const [, index, count, list] of actions.matchAll(
+    /\[(\d+)\] = \{\.entry = \{\.count = (\d+), \.reusable = \w+\}\},(.*)/g
+  )) {
+    language.actions[Number(index)] = [...list.matchAll(/(\w+)\(([^)]*)\)/g)].map(([, type, params]) => ({
+      type,
+      params: params.split(",").map((param) => param.trim()),
+    }));
+    if (language.actions[Number(index)].length !== Number(count)) throw new Error(`bad action ${index}`);
+  }
+
+  const lexModes = block(source, "static const TSLexMode ts_lex_modes[");
+  language.lexModes = [...lexModes.text.matchAll(/\[(\d+)\] = (\{.*\}),/g)].map(([, , mode]) => mode);
+  const primary = block(source, "static const TSStateId ts_primary_state_ids[");
+  language.primary = [...primary.text.matchAll(/\[(\d+)\] = (\d+),/g)].map(([, , state]) => Number(state));
+  return language;
+}
+
+function lookup(language, state, symbol) {
+  const groups = state < language.largeStateCount ? null : language.small[state];
+  if (!groups) {
+    return language.large[state].find((entry) => entry.symbol === symbol) || null;
+  }
+  for (const group of groups) {
+    if (group.symbols.includes(symbol)) return { kind: group.kind, value: group.value };
+  }
+  return null;
+}
+
+// Split a document into the tokens of the grammar. Markers start a line
+// (after the spaces, which are extras), and `word` is the rest of the line.
+function tokenize(language, text) {
+  const byText = Object.fromEntries(Object.entries(language.names).map(([symbol, name]) => [name, symbol]));
+  const markers = ["■┬", "├", "└"].map((marker) => [marker, byText[marker]]);
+  const tokens = [];
+  const lines = text.split("\n");
+  lines.forEach((line, index) => {
+    const rest = line.replace(/^ +/, "");
+    const marker = markers.find(([marker]) => rest.startsWith(marker));
+    if (marker) {
+      tokens.push(marker[1]);
+      if (rest.length > marker[0].length) tokens.push(byText.word);
+    } else if (rest) {
+      throw new Error(`unexpected line: ${line}`);
+    }
+    if (index + 1 < lines.length) tokens.push(byText["\n"]);
+  });
+  tokens.push("ts_builtin_sym_end");
+  return tokens;
+}
+
+// Run the shift/reduce loop of `ts_parser__advance` over `tokens`, counting
+// every table lookup. A reduction is taken before a repetition shift of the
+// same entry, like the runtime does.
+function profile(language, tokens, counts) {
+  const count = (state, symbol) => {
+    const key = `${state} ${symbol}`;
+    counts.set(key, (counts.get(key) || 0) + 1);
+  };
+  const stack = [1];
+  for (const token of tokens) {
+    for (;;) {
+      const state = stack[stack.length - 1];
+      count(state, token);
+      const entry = lookup(language, state, token);
+      if (!entry || entry.kind !== "ACTIONS") throw new Error(`no action for ${token} in state ${state}`);
+      const actions = language.actions[entry.value];
+      const reduce = actions.find((action) => action.type === "REDUCE");
+      if (reduce) {
+        const [symbol, childCount] = reduce.params;
+        stack.length -= Number(childCount);
+        const top = stack[stack.length - 1];
+        count(top, symbol);
+        const next = lookup(language, top, symbol);
+        if (!next || next.kind !== "STATE") throw new Error(`no goto for ${symbol} in state ${top}`);
+        stack.push(next.value);
+        continue;
+      }
+      const [action] = actions;
+      if (action.type === "SHIFT" || action.type === "SHIFT_REPEAT") {
+        stack.push(Number(action.params[0]));
+      } else if (action.type === "ACCEPT_INPUT") {
+        return;
+      } else if (action.type !== "SHIFT_EXTRA") {
+        throw new Error(`unexpected ${action.type} for ${token} in state ${state}`);
+      }
+      break;
+    }
+  }
+}
+
+// The structure of the documents of `benches/corpus/mod.rs`; line contents
+// do not matter, since every `word` is a single token
+function benchmarkDocuments() {
+  const shapes = [
+    { lines: 1000, fanOut: 10 },
+    { lines: 100000, fanOut: 1 },
+    { lines: 100000, fanOut: 10 },
+    { lines: 100000, fanOut: 100 },
+  ];
+  return shapes.map(({ lines, fanOut }) => {
+    const sections = Math.max(1, Math.floor(lines / (fanOut + 2)));
+    const section = [
+      "■┬ src/file.rs",
+      ...Array.from({ length: fanOut }, (_, i) => ` ${i + 1 === fanOut ? "└" : "├"} ${i + 1}:1  text`),
+    ].join("\n");
+    return Array(sections).fill(section).join("\n\n");
+  });
+}
+
+// The inputs of the tree-sitter test files in `corpus/`
+function corpusDocuments() {
+  const directory = path.join(root, "corpus");
+  return fs
+    .readdirSync(directory)
+    .filter((name) => name.endsWith(".txt"))
+    .flatMap((name) => {
+      const text = fs.readFileSync(path.join(directory, name), "utf8");
+      return [...text.matchAll(/^=+\n.*\n=+\n([\s\S]*?)\n---\n/gm)].map(([, input]) => input);
+    });
+}
+
+function optimize(language, counts) {
+  const weight = (state, symbol) => counts.get(`${state} ${symbol}`) || 0;
+  const stateWeight = new Map();
+  for (const [key, value] of counts) {
+    const state = Number(key.split(" ")[0]);
+    stateWeight.set(state, (stateWeight.get(state) || 0) + value);
+  }
+  const byWeight = (weightOf) => (items) =>
+    items
+      .map((item, index) => ({ item, index, weight: weightOf(item) }))
+      .sort((a, b) => b.weight - a.weight || a.index - b.index)
+      .map(({ item }) => item);
+
+  const smallStates = [];
+  for (let state = language.largeStateCount; state < language.stateCount; state++) smallStates.push(state);
+  const order = [
+    ...Array.from({ length: language.largeStateCount }, (_, state) => state),
+    ...byWeight((state) => stateWeight.get(state) || 0)(smallStates),
+  ];
+  const renumber = [];
+  order.forEach((state, index) => (renumber[state] = index));
+
+  const result = {
+    ...language,
+    large: language.large.map((entries) =>
+      entries.map((entry) => (entry.kind === "STATE" ? { ...entry, value: renumber[entry.value] } : entry))
+    ),
+    small: [],
+    actions: language.actions.map((actions) =>
+      actions.map((action) =>
+        action.type === "SHIFT" || action.type === "SHIFT_REPEAT"
+          ? { ...action, params: [String(renumber[Number(action.params[0])])] }
+          : action
+      )
+    ),
+    lexModes: order.map((state) => language.lexModes[state]),
+    primary: order.map((state) => renumber[language.primary[state]]),
+  };
+  for (const state of smallStates) {
+    const groups = language.small[state].map((group) => ({
+      ...group,
+      value: group.kind === "STATE" ? renumber[group.value] : group.value,
+      symbols: byWeight((symbol) => weight(state, symbol))(group.symbols),
+    }));
+    result.small[renumber[state]] = byWeight((group) =>
+      group.symbols.reduce((total, symbol) => total + weight(state, symbol), 0)
+    )(groups);
+  }
+  return { result, renumber };
+}
+
+// Check that every lookup of `optimized` agrees with `original`
+function verify(original, optimized, renumber) {
+  const symbols = Object.keys(original.symbols);
+  const sameAction = (a, b) => JSON.stringify(a) === JSON.stringify(b);
+  for (let state = 0; state < original.stateCount; state++) {
+    for (const symbol of symbols) {
+      const before = lookup(original, state, symbol);
+      const after = lookup(optimized, renumber[state], symbol);
+      const expected = before && {
+        kind: before.kind,
+        value: before.kind === "STATE" ? renumber[before.value] : before.value,
+      };
+      if (JSON.stringify(expected) !== JSON.stringify(after && { kind: after.kind, value: after.value })) {
+        throw new Error(`lookup of ${symbol} in state ${state} changed`);
+      }
+    }
+    if (original.lexModes[state] !== optimized.lexModes[renumber[state]]) {
+      throw new Error(`lex mode of state ${state} changed`);
+    }
+    if (renumber[original.primary[state]] !== optimized.primary[renumber[state]]) {
+      throw new Error(`primary state of state ${state} changed`);
+    }
+  }
+  original.actions.forEach((actions, index) => {
+    const renumbered = actions.map((action) =>
+      action.type === "SHIFT" || action.type === "SHIFT_REPEAT"
+        ? { ...action, params: [String(renumber[Number(action.params[0])])] }
+        : action
+    );
+    if (!sameAction(renumbered, optimized.actions[index])) throw new Error(`action ${index} changed`);
+  });
+}
+
+function render(source, language) {
+  const replace = (source, start, text) => {
+    const { begin, end } = block(source, start);
+    return source.slice(0, begin) + text + source.slice(end);
+  };
+
+  let large = `static const uint16_t ts_parse_table[LARGE_STATE_COUNT][SYMBOL_COUNT] = {\n`;
+  language.large.forEach((entries, state) => {
+    large += `  [${state}] = {\n`;
+    for (const { symbol, kind, value } of entries) large += `    [${symbol}] = ${kind}(${value}),\n`;
+    large += `  },\n`;
+  });
+  large += `};\n`;
+
+  let small = `static const uint16_t ts_small_parse_table[] = {\n`;
+  let map = `static const uint32_t ts_small_parse_table_map[] = {\n`;
+  let offset = 0;
+  for (let state = language.largeStateCount; state < language.stateCount; state++) {
+    const groups = language.small[state];
+    map += `  [SMALL_STATE(${state})] = ${offset},\n`;
+    small += `  [${offset}] = ${groups.length},\n`;
+    offset += 1;
+    for (const { kind, value, symbols } of groups) {
+      small += `    ${kind}(${value}), ${symbols.length},\n`;
+      for (const symbol of symbols) small += `      ${symbol},\n`;
+      offset += 2 + symbols.length;
+    }
+  }
+  small += `};\n`;
+  map += `};\n`;
+
+  const actions = block(source, "static const TSParseActionEntry ts_parse_actions[]").text.replace(
+    /\b(SHIFT|SHIFT_REPEAT)\((\d+)\)/g,
+    (_, type, state) => `${type}(${language.renumberShift(Number(state))})`
+  );
+  const lexModes =
+    `static const TSLexMode ts_lex_modes[STATE_COUNT] = {\n` +
+    language.lexModes.map((mode, state) => `  [${state}] = ${mode},\n`).join("") +
+    `};\n`;
+  const primary =
+    `static const TSStateId ts_primary_state_ids[STATE_COUNT] = {\n` +
+    language.primary.map((primary, state) => `  [${state}] = ${primary},\n`).join("") +
+    `};\n`;
+
+  source = replace(source, "static const uint16_t ts_parse_table[", large);
+  source = replace(source, "static const uint16_t ts_small_parse_table[]", small);
+  source = replace(source, "static const uint32_t ts_small_parse_table_map[]", map);
+  source = replace(source, "static const TSParseActionEntry ts_parse_actions[]", actions);
+  source = replace(source, "static const TSLexMode ts_lex_modes[", lexModes);
+  source = replace(source, "static const TSStateId ts_primary_state_ids[", primary);
+  if (!source.includes(MARKER)) {
+    source = source.replace("#include <tree_sitter/parser.h>\n", `#include <tree_sitter/parser.h>\n\n${MARKER}`);
+  }
+  return source;
+}
+
+// How many cache lines the entries of the states that take most of the
+// lookups are spread over
+function report(language, counts, label) {
+  const stateWeight = new Map();
+  let total = 0;
+  for (const [key, value] of counts) {
+    const state = Number(key.split(" ")[0]);
+    stateWeight.set(state, (stateWeight.get(state) || 0) + value);
+    total += value;
+  }
+  let offset = 0;
+  let covered = 0;
+  const offsets = [];
+  for (let state = language.largeStateCount; state < language.stateCount; state++) {
+    offsets[state] = offset;
+    offset += 1 + language.small[state].reduce((size, group) => size + 2 + group.symbols.length, 0);
+    offsets[state + 1] = offset;
+  }
+  const hot = [...stateWeight.entries()]
+    .filter(([state]) => state >= language.largeStateCount)
+    .sort((a, b) => b[1] - a[1]);
+  const smallTotal = hot.reduce((sum, [, weight]) => sum + weight, 0);
+  const lines = new Set();
+  for (const [state, weight] of hot) {
+    if (covered >= 0.9 * smallTotal) break;
+    covered += weight;
+    for (let entry = offsets[state]; entry < offsets[state + 1]; entry++) lines.add(Math.floor(entry / CACHE_LINE_ENTRIES));
+  }
+  console.log(
+    `${label}: ${total} lookups, 90% of the small state lookups touch ${lines.size} cache line(s) of ts_small_parse_table`
+  );
+}
+
+function main() {
+  const source = fs.readFileSync(file, "utf8");
+  const language = parse(source);
+  const documents = [...benchmarkDocuments(), ...corpusDocuments()];
+  const counts = new Map();
+  for (const document of documents) profile(language, tokenize(language, document), counts);
+
+  const { result, renumber } = optimize(language, counts);
+  verify(language, result, renumber);
+  result.renumberShift = (state) => renumber[state];
+  const optimized = render(source, result);
+
+  // The rendered file must read back as the verified tables
+  const reparsed = parse(optimized);
+  verify(language, reparsed, renumber);
+  const optimizedCounts = new Map();
+  for (const document of documents) profile(reparsed, tokenize(reparsed, document), optimizedCounts);
+
+  report(language, counts, "before");
+  report(reparsed, optimizedCounts, "after");
+  if (optimized === source) {
+    console.log(`${path.relative(process.cwd(), file)} is already optimized`);
+    return;
+  }
+  if (checkOnly) {
+    console.error(`${path.relative(process.cwd(), file)} is not optimized, run ${path.relative(process.cwd(), __filename)}`);
+    process.exit(1);
+  }
+  fs.writeFileSync(file, optimized);
+  console.log(`optimized ${path.relative(process.cwd(), file)}`);
+}
+
+main();
@@ -1,5 +1,7 @@
 #include <tree_sitter/parser.h>
 
+// Parse table optimized by script/optimize-parse-table.js
+
 #if defined(__GNUC__) || defined(__clang__)
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wmissing-field-initializers"
@@ -211,18 +213,18 @@ static const TSLexMode ts_lex_modes[STATE_COUNT] = {
   [2] = {.lex_state = 0},
   [3] = {.lex_state = 0},
   [4] = {.lex_state = 0},
-  [5] = {.lex_state = 0},
+  [5] = {.lex_state = 1},
   [6] = {.lex_state = 0},
   [7] = {.lex_state = 0},
   [8] = {.lex_state = 0},
   [9] = {.lex_state = 0},
   [10] = {.lex_state = 0},
   [11] = {.lex_state = 0},
-  [12] = {.lex_state = 0},
+  [12] = {.lex_state = 1},
   [13] = {.lex_state = 1},
   [14] = {.lex_state = 0},
-  [15] = {.lex_state = 1},
-  [16] = {.lex_state = 1},
+  [15] = {.lex_state = 0},
+  [16] = {.lex_state = 0},
   [17] = {.lex_state = 0},
 };
 
@@ -235,10 +237,10 @@ static const uint16_t ts_parse_table[LARGE_STATE_COUNT][SYMBOL_COUNT] = {
     [anon_sym_3] = ACTIONS(1),
   },
   [1] = {
-    [sym_source_file] = STATE(14),
-    [sym_section] = STATE(3),
-    [sym_header] = STATE(2),
-    [aux_sym_source_file_repeat1] = STATE(3),
+    [sym_source_file] = STATE(17),
+    [sym_section] = STATE(8),
+    [sym_header] = STATE(3),
+    [aux_sym_source_file_repeat1] = STATE(8),
     [ts_builtin_sym_end] = ACTIONS(5),
     [anon_sym_] = ACTIONS(7),
     [anon_sym_LF] = ACTIONS(3),
@@ -246,144 +248,144 @@ static const uint16_t ts_parse_table[LARGE_STATE_COUNT][SYMBOL_COUNT] = {
 };
 
 static const uint16_t ts_small_parse_table[] = {
-  [0] = 6,
-    ACTIONS(3), 1,
-      anon_sym_LF,
+  [0] = 5,
     ACTIONS(9), 1,
       anon_sym_2,
+    STATE(7), 2,
+      sym_value,
+      aux_sym_values_repeat1,
     ACTIONS(11), 1,
       anon_sym_3,
-    STATE(8), 1,
-      sym_values,
-    STATE(9), 1,
+    STATE(16), 1,
       sym_lastValue,
-    STATE(4), 2,
-      sym_value,
-      aux_sym_values_repeat1,
-  [20] = 5,
     ACTIONS(3), 1,
       anon_sym_LF,
-    ACTIONS(7), 1,
-      anon_sym_,
-    ACTIONS(13), 1,
-      ts_builtin_sym_end,
-    STATE(2), 1,
-      sym_header,
-    STATE(5), 2,
-      sym_section,
-      aux_sym_source_file_repeat1,
-  [37] = 5,
-    ACTIONS(3), 1,
-      anon_sym_LF,
-    ACTIONS(9), 1,
-      anon_sym_2,
+  [17] = 6,
+    STATE(2), 2,
+      aux_sym_values_repeat1,
+      sym_value,
+    STATE(11), 1,
+      sym_values,
     ACTIONS(11), 1,
       anon_sym_3,
-    STATE(11), 1,
+    STATE(15), 1,
       sym_lastValue,
-    STATE(6), 2,
-      sym_value,
-      aux_sym_values_repeat1,
-  [54] = 5,
-    ACTIONS(3), 1,
-      anon_sym_LF,
-    ACTIONS(15), 1,
-      ts_builtin_sym_end,
-    ACTIONS(17), 1,
-      anon_sym_,
-    STATE(2), 1,
-      sym_header,
-    STATE(5), 2,
-      sym_section,
-      aux_sym_source_file_repeat1,
-  [71] = 4,
+    ACTIONS(9), 1,
+      anon_sym_2,
     ACTIONS(3), 1,
       anon_sym_LF,
-    ACTIONS(20), 1,
+  [37] = 2,
+    ACTIONS(35), 2,
       anon_sym_2,
-    ACTIONS(23), 1,
       anon_sym_3,
-    STATE(6), 2,
-      sym_value,
-      aux_sym_values_repeat1,
-  [85] = 2,
     ACTIONS(3), 1,
       anon_sym_LF,
-    ACTIONS(25), 2,
+  [45] = 2,
+    ACTIONS(43), 1,
+      sym_word,
+    ACTIONS(37), 1,
+      anon_sym_LF,
+  [52] = 1,
+    ACTIONS(47), 1,
+      anon_sym_LF,
+  [56] = 4,
+    ACTIONS(20), 1,
       anon_sym_2,
+    ACTIONS(23), 1,
       anon_sym_3,
-  [93] = 2,
     ACTIONS(3), 1,
       anon_sym_LF,
-    ACTIONS(27), 2,
-      ts_builtin_sym_end,
+    STATE(7), 2,
+      sym_value,
+      aux_sym_values_repeat1,
+  [70] = 5,
+    ACTIONS(7), 1,
       anon_sym_,
-  [101] = 2,
+    STATE(3), 1,
+      sym_header,
+    STATE(14), 2,
+      sym_section,
+      aux_sym_source_file_repeat1,
+    ACTIONS(13), 1,
+      ts_builtin_sym_end,
     ACTIONS(3), 1,
       anon_sym_LF,
-    ACTIONS(29), 2,
-      ts_builtin_sym_end,
-      anon_sym_,
-  [109] = 2,
+  [87] = 2,
     ACTIONS(3), 1,
       anon_sym_LF,
     ACTIONS(31), 2,
-      ts_builtin_sym_end,
       anon_sym_,
-  [117] = 2,
+      ts_builtin_sym_end,
+  [95] = 2,
     ACTIONS(3), 1,
       anon_sym_LF,
-    ACTIONS(33), 2,
-      ts_builtin_sym_end,
+    ACTIONS(25), 2,
+      anon_sym_3,
+      anon_sym_2,
+  [103] = 2,
+    ACTIONS(27), 2,
       anon_sym_,
-  [125] = 2,
+      ts_builtin_sym_end,
     ACTIONS(3), 1,
       anon_sym_LF,
-    ACTIONS(35), 2,
-      anon_sym_2,
-      anon_sym_3,
-  [133] = 2,
+  [111] = 2,
+    ACTIONS(39), 1,
+      sym_word,
     ACTIONS(37), 1,
       anon_sym_LF,
-    ACTIONS(39), 1,
+  [118] = 2,
+    ACTIONS(45), 1,
       sym_word,
-  [140] = 2,
+    ACTIONS(37), 1,
+      anon_sym_LF,
+  [125] = 5,
+    ACTIONS(17), 1,
+      anon_sym_,
+    ACTIONS(15), 1,
+      ts_builtin_sym_end,
     ACTIONS(3), 1,
       anon_sym_LF,
-    ACTIONS(41), 1,
+    STATE(3), 1,
+      sym_header,
+    STATE(14), 2,
+      sym_section,
+      aux_sym_source_file_repeat1,
+  [142] = 2,
+    ACTIONS(29), 2,
+      anon_sym_,
       ts_builtin_sym_end,
-  [147] = 2,
-    ACTIONS(37), 1,
+    ACTIONS(3), 1,
       anon_sym_LF,
-    ACTIONS(43), 1,
-      sym_word,
-  [154] = 2,
-    ACTIONS(37), 1,
+  [150] = 2,
+    ACTIONS(33), 2,
+      anon_sym_,
+      ts_builtin_sym_end,
+    ACTIONS(3), 1,
       anon_sym_LF,
-    ACTIONS(45), 1,
-      sym_word,
-  [161] = 1,
-    ACTIONS(47), 1,
+  [158] = 2,
+    ACTIONS(41), 1,
+      ts_builtin_sym_end,
+    ACTIONS(3), 1,
       anon_sym_LF,
 };
 
 static const uint32_t ts_small_parse_table_map[] = {
   [SMALL_STATE(2)] = 0,
-  [SMALL_STATE(3)] = 20,
+  [SMALL_STATE(3)] = 17,
   [SMALL_STATE(4)] = 37,
-  [SMALL_STATE(5)] = 54,
-  [SMALL_STATE(6)] = 71,
-  [SMALL_STATE(7)] = 85,
-  [SMALL_STATE(8)] = 93,
-  [SMALL_STATE(9)] = 101,
-  [SMALL_STATE(10)] = 109,
-  [SMALL_STATE(11)] = 117,
-  [SMALL_STATE(12)] = 125,
-  [SMALL_STATE(13)] = 133,
-  [SMALL_STATE(14)] = 140,
-  [SMALL_STATE(15)] = 147,
-  [SMALL_STATE(16)] = 154,
-  [SMALL_STATE(17)] = 161,
+  [SMALL_STATE(5)] = 45,
+  [SMALL_STATE(6)] = 52,
+  [SMALL_STATE(7)] = 56,
+  [SMALL_STATE(8)] = 70,
+  [SMALL_STATE(9)] = 87,
+  [SMALL_STATE(10)] = 95,
+  [SMALL_STATE(11)] = 103,
+  [SMALL_STATE(12)] = 111,
+  [SMALL_STATE(13)] = 118,
+  [SMALL_STATE(14)] = 125,
+  [SMALL_STATE(15)] = 142,
+  [SMALL_STATE(16)] = 150,
+  [SMALL_STATE(17)] = 158,
 };
 
 static const TSParseActionEntry ts_parse_actions[] = {
@@ -391,13 +393,13 @@ static const TSParseActionEntry ts_parse_actions[] = {
   [1] = {.entry = {.count = 1, .reusable = false}}, RECOVER(),
   [3] = {.entry = {.count = 1, .reusable = true}}, SHIFT_EXTRA(),
   [5] = {.entry = {.count = 1, .reusable = true}}, REDUCE(sym_source_file, 0),
-  [7] = {.entry = {.count = 1, .reusable = true}}, SHIFT(13),
-  [9] = {.entry = {.count = 1, .reusable = true}}, SHIFT(15),
-  [11] = {.entry = {.count = 1, .reusable = true}}, SHIFT(16),
+  [7] = {.entry = {.count = 1, .reusable = true}}, SHIFT(12),
+  [9] = {.entry = {.count = 1, .reusable = true}}, SHIFT(5),
+  [11] = {.entry = {.count = 1, .reusable = true}}, SHIFT(13),
   [13] = {.entry = {.count = 1, .reusable = true}}, REDUCE(sym_source_file, 1),
   [15] = {.entry = {.count = 1, .reusable = true}}, REDUCE(aux_sym_source_file_repeat1, 2),
-  [17] = {.entry = {.count = 2, .reusable = true}}, REDUCE(aux_sym_source_file_repeat1, 2), SHIFT_REPEAT(13),
-  [20] = {.entry = {.count = 2, .reusable = true}}, REDUCE(aux_sym_values_repeat1, 2), SHIFT_REPEAT(15),
+  [17] = {.entry = {.count = 2, .reusable = true}}, REDUCE(aux_sym_source_file_repeat1, 2), SHIFT_REPEAT(12),
+  [20] = {.entry = {.count = 2, .reusable = true}}, REDUCE(aux_sym_values_repeat1, 2), SHIFT_REPEAT(5),
   [23] = {.entry = {.count = 1, .reusable = true}}, REDUCE(aux_sym_values_repeat1, 2),
   [25] = {.entry = {.count = 1, .reusable = true}}, REDUCE(sym_header, 2),
   [27] = {.entry = {.count = 1, .reusable = true}}, REDUCE(sym_section, 2),
@@ -406,11 +408,11 @@ static const TSParseActionEntry ts_parse_actions[] = {
   [33] = {.entry = {.count = 1, .reusable = true}}, REDUCE(sym_values, 2),
   [35] = {.entry = {.count = 1, .reusable = true}}, REDUCE(sym_value, 3),
   [37] = {.entry = {.count = 1, .reusable = false}}, SHIFT_EXTRA(),
-  [39] = {.entry = {.count = 1, .reusable = true}}, SHIFT(7),
+  [39] = {.entry = {.count = 1, .reusable = true}}, SHIFT(10),
   [41] = {.entry = {.count = 1, .reusable = true}},  ACCEPT_INPUT(),
-  [43] = {.entry = {.count = 1, .reusable = true}}, SHIFT(17),
-  [45] = {.entry = {.count = 1, .reusable = true}}, SHIFT(10),
-  [47] = {.entry = {.count = 1, .reusable = true}}, SHIFT(12),
+  [43] = {.entry = {.count = 1, .reusable = true}}, SHIFT(6),
+  [45] = {.entry = {.count = 1, .reusable = true}}, SHIFT(9),
+  [47] = {.entry = {.count = 1, .reusable = true}}, SHIFT(4),
 };
 
 #ifdef __cplusplus